@@ -0,0 +1,28 @@
+#version 330 core
+// Stream compaction: only visible instances are emitted into the
+// transform feedback buffer, as 32-byte AsteroidInstance records
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 vPosScale[];
+flat in uvec2 vOrientation[];
+flat in uint vLayer[];
+flat in uint vMesh[];
+flat in int vVisible[];
+
+out vec4 outPosScale;
+flat out uvec2 outOrientation;
+flat out uint outLayer;
+flat out uint outMesh;
+
+void main()
+{
+    if (vVisible[0] == 0)
+        return;
+    outPosScale = vPosScale[0];
+    outOrientation = vOrientation[0];
+    outLayer = vLayer[0];
+    outMesh = vMesh[0];
+    EmitVertex();
+    EndPrimitive();
+}
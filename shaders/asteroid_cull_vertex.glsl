@@ -0,0 +1,68 @@
+#version 330 core
+// One point per AsteroidInstance (same locations as asteroid_instance_vertex.glsl).
+// The orientation is read as raw int16 so it can be written back bit for bit.
+layout (location = 5) in vec4 instancePosScale;
+layout (location = 6) in ivec4 instanceOrientation;
+layout (location = 7) in uint instanceLayer;
+layout (location = 8) in uint instanceMesh;
+
+out vec4 vPosScale;
+flat out uvec2 vOrientation;
+flat out uint vLayer;
+flat out uint vMesh;
+flat out int vVisible;
+
+// Same test as AsteroidField::CullRange on the CPU
+uniform vec4 frustumPlanes[6];
+uniform vec3 eye;
+uniform float maxDistance;
+uniform vec3 coneApex;
+uniform vec3 coneDirection;
+uniform float coneCos;
+uniform float coneSin;
+
+// Local bounding sphere of the mesh being culled
+uniform vec3 meshCenter;
+uniform float meshRadius;
+
+vec3 rotateByQuat(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+bool inFrustum(vec3 c, float r)
+{
+    for (int i = 0; i < 6; i++)
+        if (dot(frustumPlanes[i].xyz, c) + frustumPlanes[i].w < -r)
+            return false;
+    return true;
+}
+
+bool inLightCone(vec3 c, float r)
+{
+    if (coneSin <= 0.0)
+        return false;
+    vec3 d = c - (coneApex - coneDirection * (r / coneSin));
+    float along = dot(d, coneDirection);
+    return along > 0.0 && along * along >= dot(d, d) * coneCos * coneCos;
+}
+
+void main()
+{
+    vec4 q = normalize(vec4(instanceOrientation) / 32767.0);
+    float scale = instancePosScale.w;
+    vec3 center = instancePosScale.xyz + scale * rotateByQuat(q, meshCenter);
+    float radius = meshRadius * scale;
+
+    float reach = maxDistance + radius;
+    vec3 toEye = center - eye;
+    bool inRange = dot(toEye, toEye) < reach * reach;
+    vVisible = (inFrustum(center, radius) && (inRange || inLightCone(center, radius))) ? 1 : 0;
+
+    // Repack the int16 pairs exactly as they sit in AsteroidInstance
+    vPosScale = instancePosScale;
+    vOrientation = uvec2((uint(instanceOrientation.x) & 0xFFFFu) | (uint(instanceOrientation.y) << 16),
+                         (uint(instanceOrientation.z) & 0xFFFFu) | (uint(instanceOrientation.w) << 16));
+    vLayer = instanceLayer;
+    vMesh = instanceMesh;
+}
@@ -0,0 +1,154 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec2 TexCoords;
+flat in vec3 BakeRight;
+flat in vec3 BakeUp;
+flat in vec3 BakeForward;
+
+uniform sampler2D impostorAlbedo;
+uniform sampler2D impostorNormal;
+
+// Same per-frame blocks as fragment.glsl (engine/uniform_blocks.h). The
+// atlas has no specular channel, so only the ambient and diffuse terms are used.
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+};
+
+struct SpotLight {
+    vec3 position;
+    float cutOff;
+    vec3 direction;
+    float outerCutOff;
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    vec2 clusterTileSize;    // pixels
+    float clusterNear;
+    float clusterDepthScale; // slices per unit of log(depth / clusterNear)
+    int clusterCountX;
+    int clusterCountY;
+    int clusterCountZ;
+    float brightness;
+};
+
+// Clustered point lights (engine/light_clusters.h): 4 texels per light, an
+// (offset, count) pair per cluster and the clusters' light index lists
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLights;
+
+PointLight FetchPointLight(int index)
+{
+    vec4 t0 = texelFetch(lightData, index * 4);
+    vec4 t1 = texelFetch(lightData, index * 4 + 1);
+    vec4 t2 = texelFetch(lightData, index * 4 + 2);
+    vec4 t3 = texelFetch(lightData, index * 4 + 3);
+    return PointLight(t0.xyz, t0.w, t1.xyz, t1.w, t2.xyz, t2.w, t3.xyz, t3.w);
+}
+
+// (first index, count) of the lights reaching this fragment's cluster
+uvec2 ClusterLightRange(vec3 fragPos)
+{
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = int(log(max(depth, clusterNear) / clusterNear) * clusterDepthScale);
+    ivec2 tile = ivec2(gl_FragCoord.xy / clusterTileSize);
+    ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), ivec3(clusterCountX, clusterCountY, clusterCountZ) - 1);
+    return texelFetch(clusterGrid, (cluster.z * clusterCountY + cluster.y) * clusterCountX + cluster.x).xy;
+}
+
+// Fades a light to zero at its cluster radius, so the cut is invisible
+float RadiusFalloff(float distance, float radius)
+{
+    float x = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+    return x * x;
+}
+
+layout (std140) uniform Fog {
+    vec3 fogColor;
+    float fogStart;
+    float fogEnd;
+    bool useFog;
+};
+
+float Attenuation(float constant, float linear, float quadratic, float distance)
+{
+    return 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+}
+
+void main()
+{
+    vec4 albedo = texture(impostorAlbedo, TexCoords);
+    if (albedo.a < 0.5)
+        discard;
+    vec3 diffColor = albedo.rgb;
+
+    vec3 baked = texture(impostorNormal, TexCoords).xyz * 2.0 - 1.0;
+    vec3 norm = normalize(baked.x * BakeRight + baked.y * BakeUp + baked.z * BakeForward);
+
+    // Directional light
+    vec3 lightDir = normalize(-dirLight.direction);
+    vec3 result = dirLight.ambient * diffColor + dirLight.diffuse * max(dot(norm, lightDir), 0.0) * diffColor;
+
+    // Point lights
+    uvec2 lightRange = ClusterLightRange(FragPos);
+    for (uint i = 0u; i < lightRange.y; i++) {
+        PointLight light = FetchPointLight(int(texelFetch(clusterLights, int(lightRange.x + i)).r));
+        vec3 toLight = light.position - FragPos;
+        float distance = length(toLight);
+        float attenuation = Attenuation(light.constant, light.linear, light.quadratic, distance) * RadiusFalloff(distance, light.radius);
+        float diff = max(dot(norm, normalize(toLight)), 0.0);
+        result += (light.ambient + light.diffuse * diff) * diffColor * attenuation;
+    }
+
+    // Spot light (flipped normal, as in fragment.glsl)
+    vec3 toSpot = spotLight.position - FragPos;
+    vec3 spotDir = normalize(toSpot);
+    float theta = dot(spotDir, normalize(-spotLight.direction));
+    float intensity = clamp((theta - spotLight.outerCutOff) / (spotLight.cutOff - spotLight.outerCutOff), 0.0, 1.0);
+    float spotAttenuation = Attenuation(spotLight.constant, spotLight.linear, spotLight.quadratic, length(toSpot));
+    float spotDiff = max(dot(-norm, spotDir), 0.0);
+    vec3 spotLightResult = (spotLight.ambient + spotLight.diffuse * spotDiff) * diffColor * spotAttenuation * intensity;
+
+    result *= brightness;
+
+    if (useFog) {
+        float dist = length(viewPos - FragPos);
+        float fogFactor = clamp((fogEnd - dist) / (fogEnd - fogStart), 0.0, 1.0);
+        result = mix(fogColor, result, fogFactor);
+    }
+
+    // Add spotlight AFTER fog to cut through it
+    result += spotLightResult * brightness;
+
+    FragColor = vec4(result, 1.0);
+}
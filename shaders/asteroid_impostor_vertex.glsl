@@ -0,0 +1,84 @@
+#version 330 core
+// Camera-facing quad for a distant asteroid, textured with the atlas tile
+// baked from the direction closest to the one it is seen from
+layout (location = 0) in vec2 aCorner; // xy of the quad vertex in the geometry arena, (-1, -1) .. (1, 1)
+
+// AsteroidInstance (same layout as asteroid_instance_vertex.glsl) + mesh index
+layout (location = 5) in vec4 instancePosScale;
+layout (location = 6) in vec4 instanceOrientation;
+layout (location = 7) in uint instanceLayer;
+layout (location = 8) in uint instanceMesh;
+
+out vec3 FragPos;
+out vec2 TexCoords;
+// World-space frame of the chosen bake camera, to decode the baked normal
+flat out vec3 BakeRight;
+flat out vec3 BakeUp;
+flat out vec3 BakeForward;
+
+// Per-frame blocks shared by every program (engine/uniform_blocks.h)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+// Atlas layout, set once by ImpostorAtlas::SetUniforms
+#define MAX_VIEWS 32
+#define MAX_MESHES 16
+uniform int viewCount;
+uniform int layerCount;
+uniform int atlasColumns;
+uniform vec2 tileSize; // in UV units
+uniform float tileInset; // gutter on each side, as a fraction of the tile
+uniform float boundsPadding;
+uniform vec3 impostorDirections[MAX_VIEWS];
+uniform vec3 impostorRights[MAX_VIEWS];
+uniform vec3 impostorUps[MAX_VIEWS];
+uniform vec3 meshCenters[MAX_MESHES];
+uniform float meshRadii[MAX_MESHES];
+
+vec3 rotateByQuat(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    vec4 q = normalize(instanceOrientation);
+    vec4 qInverse = vec4(-q.xyz, q.w);
+    float scale = instancePosScale.w;
+    int mesh = int(instanceMesh);
+    vec3 center = instancePosScale.xyz + scale * rotateByQuat(q, meshCenters[mesh]);
+
+    // Baked view closest to the camera, compared in the asteroid's local frame
+    vec3 toEye = viewPos - center;
+    vec3 toEyeLocal = rotateByQuat(qInverse, toEye);
+    int best = 0;
+    float bestDot = -2.0;
+    for (int i = 0; i < viewCount; i++) {
+        float d = dot(toEyeLocal, impostorDirections[i]);
+        if (d > bestDot) {
+            bestDot = d;
+            best = i;
+        }
+    }
+    BakeRight = rotateByQuat(q, impostorRights[best]);
+    BakeUp = rotateByQuat(q, impostorUps[best]);
+    BakeForward = rotateByQuat(q, impostorDirections[best]);
+
+    // Face the camera exactly, keeping the tile's up axis as the roll reference
+    vec3 forward = normalize(toEye);
+    vec3 right = cross(BakeUp, forward);
+    right = dot(right, right) > 1e-6 ? normalize(right) : BakeRight;
+    vec3 up = cross(forward, right);
+
+    float extent = meshRadii[mesh] * boundsPadding * scale;
+    FragPos = center + (right * aCorner.x + up * aCorner.y) * extent;
+
+    int tile = (mesh * layerCount + int(instanceLayer)) * viewCount + best;
+    vec2 cell = vec2(tile % atlasColumns, tile / atlasColumns);
+    TexCoords = (cell + tileInset + (aCorner * 0.5 + 0.5) * (1.0 - 2.0 * tileInset)) * tileSize;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
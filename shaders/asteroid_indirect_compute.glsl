@@ -0,0 +1,117 @@
+#version 430 core
+// GL 4.5 asteroid path: culls every AsteroidInstance of the frame, picks its
+// LOD (or the impostor) and appends it to that draw's region of the output
+// buffer, counting it in the draw's indirect command. The commands then feed
+// one glMultiDrawElementsIndirect with no readback.
+layout (local_size_x = 64) in;
+
+// Same 32-byte layout as AsteroidInstance; the orientation stays packed int16
+struct Instance {
+    vec4 posScale;
+    uvec2 orientation;
+    uint layer;
+    uint mesh;
+};
+
+// DrawElementsIndirectCommand
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer InputInstances { Instance inputs[]; };
+layout (std430, binding = 1) writeonly buffer OutputInstances { Instance outputs[]; };
+layout (std430, binding = 2) buffer Commands { Command commands[]; };
+
+uniform int firstInput; // this frame's slot of the input ring
+uniform int inputCount;
+
+// Same test as AsteroidField::CullRange on the CPU
+uniform vec4 frustumPlanes[6];
+uniform vec3 eye;
+uniform float maxDistance;
+uniform vec3 coneApex;
+uniform vec3 coneDirection;
+uniform float coneCos;
+uniform float coneSin;
+
+// Same choice as AsteroidField::SelectLod
+#define MAX_MESHES 16
+#define LOD_LEVELS 4
+uniform float lodScale;
+uniform float lodPixels[LOD_LEVELS - 1];
+uniform int meshCount;
+uniform int meshBatchStart[MAX_MESHES + 1]; // first command of each mesh
+uniform vec3 meshCenters[MAX_MESHES];
+uniform float meshRadii[MAX_MESHES];
+uniform int impostorCommand;
+uniform int impostorMeshCount; // 0 when impostors are off
+uniform float impostorDistance;
+uniform float impostorPixels; // ImpostorAtlas::MaxScreenRadius
+
+vec3 rotateByQuat(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+bool inFrustum(vec3 c, float r)
+{
+    for (int i = 0; i < 6; i++)
+        if (dot(frustumPlanes[i].xyz, c) + frustumPlanes[i].w < -r)
+            return false;
+    return true;
+}
+
+bool inLightCone(vec3 c, float r)
+{
+    if (coneSin <= 0.0)
+        return false;
+    vec3 d = c - (coneApex - coneDirection * (r / coneSin));
+    float along = dot(d, coneDirection);
+    return along > 0.0 && along * along >= dot(d, d) * coneCos * coneCos;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(inputCount))
+        return;
+    Instance inst = inputs[uint(firstInput) + id];
+    int mesh = int(inst.mesh);
+    if (mesh >= meshCount)
+        return;
+
+    // snorm16 pairs, low half first
+    ivec2 halves = ivec2(inst.orientation);
+    vec4 q = normalize(vec4(bitfieldExtract(halves.x, 0, 16), bitfieldExtract(halves.x, 16, 16),
+                            bitfieldExtract(halves.y, 0, 16), bitfieldExtract(halves.y, 16, 16)) / 32767.0);
+    float scale = inst.posScale.w;
+    vec3 center = inst.posScale.xyz + scale * rotateByQuat(q, meshCenters[mesh]);
+    float radius = meshRadii[mesh] * scale;
+
+    vec3 toEye = center - eye;
+    float reach = maxDistance + radius;
+    bool inRange = dot(toEye, toEye) < reach * reach;
+    if (!inFrustum(center, radius) || !(inRange || inLightCone(center, radius)))
+        return;
+
+    float distance = max(length(toEye), 0.001);
+    int command;
+    float pixels = radius * lodScale / distance;
+    if (mesh < impostorMeshCount && distance > impostorDistance && pixels <= impostorPixels) {
+        command = impostorCommand;
+    } else {
+        int first = meshBatchStart[mesh];
+        int lodCount = meshBatchStart[mesh + 1] - first;
+        int lod = 0;
+        while (lod + 1 < lodCount && pixels < lodPixels[lod])
+            lod++;
+        command = first + lod;
+    }
+
+    uint slot = atomicAdd(commands[command].instanceCount, 1u);
+    outputs[commands[command].baseInstance + slot] = inst;
+}
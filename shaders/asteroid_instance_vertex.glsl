@@ -6,15 +6,37 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out int TextureLayer;
+flat out vec4 InstanceColor; // only used by instanced items
 
-layout (location = 5) in mat4 instanceModel;
-uniform mat4 view;
-uniform mat4 projection;
+// Compact instance record (AsteroidInstance): position + uniform scale,
+// orientation quaternion and texture layer (location 8, the mesh index, is
+// only read by the culling and impostor shaders)
+layout (location = 5) in vec4 instancePosScale;
+layout (location = 6) in vec4 instanceOrientation;
+layout (location = 7) in uint instanceLayer;
+
+// Per-frame blocks shared by every program (engine/uniform_blocks.h)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+vec3 rotateByQuat(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main()
 {
-    FragPos = vec3(instanceModel * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(instanceModel))) * aNormal;  
+    // snorm16 quantization leaves the quaternion slightly off unit length
+    vec4 q = normalize(instanceOrientation);
+    FragPos = instancePosScale.xyz + instancePosScale.w * rotateByQuat(q, aPos);
+    // Uniform scale: the normal matrix is just the rotation
+    Normal = rotateByQuat(q, aNormal);
     TexCoords = aTexCoords;
+    TextureLayer = int(instanceLayer);
+    InstanceColor = vec4(0.0);
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
@@ -4,8 +4,16 @@ out vec4 FragColor;
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+flat in int TextureLayer;
+flat in vec4 InstanceColor; // instanced items: rgb color, a = 1 when unlit
+
+// Per-frame blocks shared by every program (engine/uniform_blocks.h)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
-uniform vec3 viewPos;
 uniform bool useSingleColor;
 uniform vec3 singleColor;
 uniform vec3 objectColor;
@@ -13,13 +21,19 @@ uniform float alpha = 1.0;
 
 uniform bool isUnlit;
 uniform int hasDiffuse;
-uniform float brightness = 1.0;
+
+// Instanced items take objectColor and isUnlit from InstanceColor instead
+uniform bool useInstanceColor = false;
 
 // Material properties
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 uniform float materialShininess = 32.0;
 
+// Asteroids: diffuse color from layer TextureLayer of a texture array
+uniform bool useTextureArray = false;
+uniform sampler2DArray texture_array;
+
 // Directional Light
 struct DirLight {
     vec3 direction;
@@ -27,46 +41,84 @@ struct DirLight {
     vec3 diffuse;
     vec3 specular;
 };
-uniform DirLight dirLight;
 
-// Point Light
+// Point Light, unpacked from the lightData texture buffer
 struct PointLight {
     vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;
-    
+    float radius;
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 };
-#define MAX_POINT_LIGHTS 20
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
-uniform int nPointLights;
 
 // Spot Light
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    vec2 clusterTileSize;    // pixels
+    float clusterNear;
+    float clusterDepthScale; // slices per unit of log(depth / clusterNear)
+    int clusterCountX;
+    int clusterCountY;
+    int clusterCountZ;
+    float brightness;
 };
-uniform SpotLight spotLight;
+
+// Clustered point lights (engine/light_clusters.h): 4 texels per light, an
+// (offset, count) pair per cluster and the clusters' light index lists
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLights;
+
+PointLight FetchPointLight(int index)
+{
+    vec4 t0 = texelFetch(lightData, index * 4);
+    vec4 t1 = texelFetch(lightData, index * 4 + 1);
+    vec4 t2 = texelFetch(lightData, index * 4 + 2);
+    vec4 t3 = texelFetch(lightData, index * 4 + 3);
+    return PointLight(t0.xyz, t0.w, t1.xyz, t1.w, t2.xyz, t2.w, t3.xyz, t3.w);
+}
+
+// (first index, count) of the lights reaching this fragment's cluster
+uvec2 ClusterLightRange(vec3 fragPos)
+{
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = int(log(max(depth, clusterNear) / clusterNear) * clusterDepthScale);
+    ivec2 tile = ivec2(gl_FragCoord.xy / clusterTileSize);
+    ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), ivec3(clusterCountX, clusterCountY, clusterCountZ) - 1);
+    return texelFetch(clusterGrid, (cluster.z * clusterCountY + cluster.y) * clusterCountX + cluster.x).xy;
+}
+
+// Fades a light to zero at its cluster radius, so the cut is invisible
+float RadiusFalloff(float distance, float radius)
+{
+    float x = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+    return x * x;
+}
 
 // Fog
-uniform bool useFog = false;
-uniform vec3 fogColor = vec3(0.0, 0.0, 0.0);
-uniform float fogStart = 50.0;
-uniform float fogEnd = 100.0;
+layout (std140) uniform Fog {
+    vec3 fogColor;
+    float fogStart;
+    float fogEnd;
+    bool useFog;
+};
 
 // Function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffColor, vec3 specColor);
@@ -82,14 +134,17 @@ void main()
         return;
     }
 
+    vec3 baseColor = useInstanceColor ? InstanceColor.rgb : objectColor;
+    bool unlit = useInstanceColor ? InstanceColor.a > 0.5 : isUnlit;
+
     // Unlit mode for Skybox (Just return texture color)
-    if(isUnlit)
+    if(unlit)
     {
         vec3 color;
         if(hasDiffuse == 1)
             color = texture(texture_diffuse1, TexCoords).rgb;
         else
-            color = objectColor;
+            color = baseColor;
             
         FragColor = vec4(color, alpha);
         return;
@@ -98,14 +153,19 @@ void main()
     // Determine material colors
     vec3 diffColor;
     vec3 specColor;
-    if (hasDiffuse == 1)
+    if (useTextureArray)
+    {
+        diffColor = texture(texture_array, vec3(TexCoords, TextureLayer)).rgb;
+        specColor = vec3(0.5); // Default specular
+    }
+    else if (hasDiffuse == 1)
     {
         diffColor = vec3(texture(texture_diffuse1, TexCoords));
         specColor = vec3(texture(texture_specular1, TexCoords).r);
     }
     else
     {
-        diffColor = objectColor;
+        diffColor = baseColor;
         specColor = vec3(0.5); // Default specular
     }
 
@@ -116,9 +176,12 @@ void main()
     // Phase 1: Directional lighting
     vec3 result = CalcDirLight(dirLight, norm, viewDir, diffColor, specColor);
     
-    // Phase 2: Point lights
-    for(int i = 0; i < nPointLights; i++)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, diffColor, specColor);    
+    // Phase 2: Point lights reaching this fragment's cluster
+    uvec2 lightRange = ClusterLightRange(FragPos);
+    for(uint i = 0u; i < lightRange.y; i++) {
+        int index = int(texelFetch(clusterLights, int(lightRange.x + i)).r);
+        result += CalcPointLight(FetchPointLight(index), norm, FragPos, viewDir, diffColor, specColor);
+    }
     
     // Phase 3: Spot light
     norm = -norm;
@@ -168,6 +231,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     // Attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    attenuation *= RadiusFalloff(distance, light.radius);
     // Combine results
     vec3 ambient = light.ambient * diffColor;
     vec3 diffuse = light.diffuse * diff * diffColor;
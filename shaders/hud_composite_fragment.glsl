@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// Cached HUD (engine/hud_layer.h), transparent where nothing was drawn
+uniform sampler2D hudTexture;
+
+void main()
+{
+    FragColor = texture(hudTexture, TexCoords);
+}
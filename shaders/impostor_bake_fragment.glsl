@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalOut;
+
+in vec3 ViewNormal;
+in vec2 TexCoords;
+
+// Layer of the asteroid texture array being baked
+uniform sampler2DArray texture_array;
+uniform int layer;
+
+void main()
+{
+    vec3 color = texture(texture_array, vec3(TexCoords, layer)).rgb;
+    // Alpha marks covered texels, the cleared background stays at 0
+    Albedo = vec4(color, 1.0);
+    // Normal in the bake camera frame (x = right, y = up, z = toward the camera)
+    NormalOut = vec4(normalize(ViewNormal) * 0.5 + 0.5, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+// Renders a mesh in its local space into one tile of the impostor atlas
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 ViewNormal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    // The bake camera has no scale, so mat3(view) is the normal matrix
+    ViewNormal = mat3(view) * aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
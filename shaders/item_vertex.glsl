@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+// Per instance (ItemInstance in game_item.h)
+layout (location = 3) in vec3 instancePosition;
+layout (location = 4) in vec3 instanceScale;
+layout (location = 5) in vec4 instanceColor; // rgb, a = 1 when unlit
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out int TextureLayer;
+flat out vec4 InstanceColor;
+
+// 1 for the items, ITEM_OUTLINE_SCALE for their outline hull
+uniform float outlineScale = 1.0;
+
+// Per-frame blocks shared by every program (engine/uniform_blocks.h)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+void main()
+{
+    vec3 scale = instanceScale * outlineScale;
+    FragPos = instancePosition + scale * aPos;
+    // Axis-aligned scale: the normal matrix is the inverse scale
+    Normal = aNormal / scale;
+    TexCoords = aTexCoords;
+    TextureLayer = 0;
+    InstanceColor = instanceColor;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
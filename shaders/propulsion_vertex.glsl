@@ -7,8 +7,14 @@ out vec2 TexCoords;
 out float Displacement;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Per-frame blocks shared by every program (engine/uniform_blocks.h)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
 uniform float time;
 uniform float thrustLevel; // 0.0 to 1.0
 
@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec4 Color;
+
+// 1-bit bitmap font atlas
+uniform sampler2D glyphAtlas;
+
+void main()
+{
+    if (texture(glyphAtlas, TexCoords).r < 0.5)
+        discard;
+    FragColor = Color;
+}
@@ -6,16 +6,25 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out int TextureLayer; // only used with the asteroid texture array
+flat out vec4 InstanceColor; // only used by instanced items
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Per-frame blocks shared by every program (engine/uniform_blocks.h)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;  
     TexCoords = aTexCoords;
+    TextureLayer = 0;
+    InstanceColor = vec4(0.0);
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
@@ -7,131 +7,1057 @@
 #include <vector>
 #include <cstdlib>
 #include <algorithm>
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 
 #include "engine/model.h"
 #include "engine/shader.h"
+#include "engine/gl_state.h"
 #include "engine/primitives.h"
+#include "engine/instance_buffer.h"
+#include "engine/geometry_arena.h"
+#include "engine/spatial_hash.h"
+#include "engine/jobs.h"
+#include "engine/frustum.h"
+#include "engine/impostor_atlas.h"
+#include "engine/gl45.h"
 #include "asteroid.h"
+#include "asteroidStore.h"
+
+// Compact per-instance record (32 bytes instead of a 64-byte mat4).
+// asteroid_instance_vertex.glsl rebuilds the transform from it; the scale is
+// uniform, so normals are just rotated by the quaternion. The mesh index is
+// only needed by impostors, which draw every mesh with the same quad.
+struct AsteroidInstance {
+    glm::vec3 position;     // location 5 (xyz)
+    float scale;            // location 5 (w)
+    int16_t orientation[4]; // location 6, snorm16 quaternion (x, y, z, w)
+    uint32_t layer;         // location 7, texture layer
+    uint32_t mesh;          // location 8, mesh index
+};
+static_assert(sizeof(AsteroidInstance) == 32, "AsteroidInstance must stay 32 bytes");
+
+inline int16_t PackSnorm16(float v) {
+    return (int16_t)std::lround(glm::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+// One batch's slice of a GPU culling pass: where its visible records were
+// written by transform feedback and the query that counts them
+struct CulledInstances {
+    unsigned int query;
+    size_t first;      // first record in the pass's output buffer
+    size_t inputCount; // instances submitted to the culling pass
+    bool pending;      // query issued and not read yet
+};
+
+// One instanced draw per asteroid mesh and LOD. All batches draw from the
+// field's geometry arena through one VAO; this frame's instances of the batch
+// are the range [firstInstance, firstInstance + instanceCount) of the field's
+// instance buffer.
+struct InstanceBatch {
+    int meshIndex;
+    int baseVertex;           // of the mesh in the arena
+    unsigned int indexOffset; // first index of the LOD range in the arena EBO
+    unsigned int indexCount;
+    size_t firstInstance;
+    size_t instanceCount;
+
+    // GPU culling (see AsteroidField::EnableGpuCulling), ping-ponged between frames
+    CulledInstances culled[2];
+    unsigned int visibleCount; // result of the last query read
+};
+
+// Asteroids per job when the field is split across the job system.
+// A multiple of 8 so every chunk but the last runs the full-width SIMD kernels.
+const size_t ASTEROID_JOB_GRAIN = 2048;
+
+// The drift check walks 1/ASTEROID_DESPAWN_SLICES of the field per frame, so
+// every asteroid is checked about once a second at 60 fps. Merging new cells
+// is capped to the same number of asteroids per frame.
+const size_t ASTEROID_DESPAWN_SLICES = 60;
+// LOD selection: an asteroid whose bounding sphere covers fewer than
+// ASTEROID_LOD_PIXELS[k] pixels of radius on screen uses LOD k + 1 (if the mesh has it)
+const int ASTEROID_LOD_LEVELS = 4;
+const float ASTEROID_LOD_PIXELS[ASTEROID_LOD_LEVELS - 1] = { 48.0f, 16.0f, 6.0f };
+
+// Texture unit of the asteroid texture array. Kept apart from the units the
+// mesh materials use, since samplers of different types can't share a unit.
+const int ASTEROID_TEXTURE_UNIT = 8;
+
+// Corners of the impostor quad and its two triangles. It is indexed like the
+// meshes so the GL 4.5 path can draw it from the same command buffer.
+const float IMPOSTOR_QUAD[8] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+const unsigned int IMPOSTOR_QUAD_INDICES[6] = { 0, 1, 2, 2, 1, 3 };
+
+// Slots of the persistently mapped instance ring used by the GL 4.5 path:
+// the CPU writes one while the GPU may still read the previous two
+const unsigned int ASTEROID_FRAMES_IN_FLIGHT = 3;
+// Longest wait for a ring slot; past it the GPU is assumed hung
+const GLuint64 ASTEROID_FENCE_TIMEOUT_NS = 1000000000;
+// Limit of the per-mesh uniform arrays in asteroid_indirect_compute.glsl
+const int ASTEROID_INDIRECT_MAX_MESHES = 16;
+
+// Uniforms of the two GPU culling programs (asteroid_cull_vertex.glsl and
+// asteroid_indirect_compute.glsl), resolved once when their path is enabled.
+// A uniform the program doesn't declare gets location -1, which GL ignores.
+struct AsteroidCullUniforms {
+    UniformHandle frustumPlanes, eye, maxDistance;
+    UniformHandle coneApex, coneDirection, coneCos, coneSin;
+    UniformHandle meshCenter, meshRadius; // per batch, transform feedback pass
+    UniformHandle firstInput, inputCount, lodScale;
+    UniformHandle impostorMeshCount, impostorDistance, impostorPixels;
+
+    AsteroidCullUniforms() {}
+    explicit AsteroidCullUniforms(const Shader& shader)
+        : frustumPlanes(shader.handle("frustumPlanes")), eye(shader.handle("eye")),
+          maxDistance(shader.handle("maxDistance")), coneApex(shader.handle("coneApex")),
+          coneDirection(shader.handle("coneDirection")), coneCos(shader.handle("coneCos")),
+          coneSin(shader.handle("coneSin")), meshCenter(shader.handle("meshCenter")),
+          meshRadius(shader.handle("meshRadius")), firstInput(shader.handle("firstInput")),
+          inputCount(shader.handle("inputCount")), lodScale(shader.handle("lodScale")),
+          impostorMeshCount(shader.handle("impostorMeshCount")), impostorDistance(shader.handle("impostorDistance")),
+          impostorPixels(shader.handle("impostorPixels")) {}
+};
+
+// What the camera can see this frame. Asteroids outside the frustum, or past
+// maxDistance (fully fogged) and outside the light cone that is added after
+// the fog, are not drawn.
+struct AsteroidView {
+    Frustum frustum;
+    glm::vec3 eye;
+    float maxDistance;
+    Cone lightCone;
+    float lodScale; // screen pixels covered by one world unit at distance 1
+};
+
+// One streamed cell of the field (see GenerateAsteroidCell). asteroids is
+// filled by a background job and kept after the cell is merged into the
+// field: it is the untouched copy that drifting asteroids are reset to.
+struct AsteroidCell {
+    glm::ivec3 coord;
+    AsteroidStore asteroids;
+    std::atomic<bool> ready; // generation job finished
+    size_t mergedCount;      // asteroids copied into the field so far
+};
 
 struct AsteroidField {
-    std::vector<Asteroid> asteroids;
+    AsteroidStore asteroids;
+    JobSystem* jobs;
     Model* asteroidModel;
-    std::vector<unsigned int> textures;
-    float lastSpawnCheckTime;
-    float spawnRadius;
-    float despawnRadius;
-    unsigned int maxAsteroids;
-    float ySpan;
-
+    unsigned int textureArray; // GL_TEXTURE_2D_ARRAY, one layer per asteroid texture
+    int textureLayers;
+    float spawnRadius;   // cells closer than this to the player are loaded
+    float despawnRadius; // cells farther than this are dropped
+    unsigned int maxAsteroids; // capacity; cells that don't fit wait until others are dropped
+    uint64_t seed;
+    std::unordered_map<uint64_t, std::unique_ptr<AsteroidCell> > cells; // by AsteroidCellKey
+    std::atomic<int> cellJobs;         // generation jobs in flight
+    std::vector<uint64_t> droppedCells; // scratch for DropCells
+    // Every mesh plus the impostor quad in one VBO/EBO, drawn through one VAO
+    // whose instance attributes are re-pointed per batch (GL 3.3 has no base instance)
+    GeometryArena geometry;
+    GeometryRange impostorQuad;
+    unsigned int VAO;
+    InstanceBuffer instanceBuffer;
+    std::vector<AsteroidInstance> instances; // every bucket back to back, rebuilt each frame
+    std::vector<InstanceBatch> batches;    // grouped by mesh, then LOD
+    std::vector<size_t> meshBatchStart;    // first batch of each mesh (+ end marker)
+    std::vector<glm::vec3> meshCenters;
+    std::vector<float> meshRadii;
+    SpatialHash broadphase;
+    std::vector<size_t> chunkOffsets; // per (chunk, batch) write cursors used by BuildInstances
+    AsteroidView view;
+    bool hasView;                     // no culling until SetView is called
+    std::vector<unsigned char> visible; // per asteroid, written by BuildInstances
+    std::vector<int> batchOf;           // per asteroid batch this frame, -1 if culled
+    size_t drawnCount;
+    size_t culledCount;
+    size_t impostorCount; // part of drawnCount
+    // Impostors: asteroids farther than impostorDistance are drawn as quads
+    // from the atlas, all meshes and textures in one instanced draw.
+    // They are bucketed by BuildInstances after the mesh batches.
+    const ImpostorAtlas* impostorAtlas; // nullptr until EnableImpostors
+    Shader* impostorShader;
+    float impostorDistance;
+    size_t impostorFirst; // first impostor record in instances
+    // GPU culling: frame N culls into culledBuffers[N % 2] and draws
+    // culledBuffers[(N + 1) % 2], the previous frame's output, whose query
+    // results are ready by then. Each batch writes at its own firstInstance.
+    Shader* cullShader;  // nullptr until EnableGpuCulling
+    AsteroidCullUniforms cullUniforms;
+    unsigned int cullVAO; // the instance buffer read as points
+    unsigned int culledBuffers[2];
+    size_t culledCapacity[2]; // bytes
+    bool gpuCulling;     // use the GPU path instead of CullRange
+    unsigned int cullFrame;
+    // GL 4.5 path (see EnableIndirectDraw): BuildInstances writes every
+    // asteroid, unculled, straight into a persistently mapped ring slot; a
+    // compute pass culls them, picks the LOD and fills one indirect command
+    // per batch (plus one for impostors), and a single
+    // glMultiDrawElementsIndirect draws every mesh and LOD.
+    Shader* indirectShader; // nullptr until EnableIndirectDraw
+    AsteroidCullUniforms indirectUniforms;
+    bool indirectDraw;      // use it instead of the 3.3 paths
+    unsigned int indirectVAO;
+    unsigned int streamBuffer; // ASTEROID_FRAMES_IN_FLIGHT slots of maxAsteroids records
+    AsteroidInstance* streamData;
+    size_t streamCapacity;     // records per slot
+    GLsync streamFences[ASTEROID_FRAMES_IN_FLIGHT];
+    size_t streamCount[ASTEROID_FRAMES_IN_FLIGHT]; // records written to each slot
+    unsigned int streamSlot;   // slot the next BuildInstances writes
+    unsigned int sortedBuffer; // compute output, maxAsteroids records per command
+    unsigned int commandBuffer;
+    std::vector<DrawElementsIndirectCommand> commands; // instanceCount 0, reset each frame
+    // The commands of each slot are copied here after the pass and summed
+    // once the slot's fence has been waited on, so reading them adds no wait
+    unsigned int statsBuffer;
+    const DrawElementsIndirectCommand* statsData;
+    size_t despawnCursor; // next asteroid checked by the time-sliced drift check
 
-    AsteroidField(Model* model, const std::vector<unsigned int>& texs, int amount, float spawnRadius, float despawnRadius) {
+    AsteroidField(JobSystem& jobs, uint64_t seed, Model* model, unsigned int textureArray, int textureLayers, int amount, float spawnRadius, float despawnRadius) {
+        this->jobs = &jobs;
+        this->seed = seed;
         this->asteroidModel = model;
-        this->textures = texs;
-        this->lastSpawnCheckTime = 0.0f;
+        this->textureArray = textureArray;
+        this->textureLayers = textureLayers;
+        this->despawnCursor = 0;
+        this->hasView = false;
+        this->drawnCount = 0;
+        this->culledCount = 0;
+        this->impostorCount = 0;
+        this->impostorAtlas = nullptr;
+        this->impostorShader = nullptr;
+        this->impostorDistance = 0.0f;
+        this->impostorFirst = 0;
+        this->cullShader = nullptr;
+        this->gpuCulling = false;
+        this->cullFrame = 0;
+        this->indirectShader = nullptr;
+        this->indirectDraw = false;
+        this->streamData = nullptr;
+        this->streamCapacity = 0;
+        this->streamSlot = 0;
+        this->statsData = nullptr;
+        for (unsigned int k = 0; k < ASTEROID_FRAMES_IN_FLIGHT; k++) {
+            this->streamFences[k] = nullptr;
+            this->streamCount[k] = 0;
+        }
+        this->cellJobs.store(0);
         this->spawnRadius = spawnRadius;
         this->despawnRadius = despawnRadius;
         this->maxAsteroids = amount;
-        this->ySpan = 50.0f;
-        for(unsigned int i = 0; i < amount; i++) {
-            // Initial generation: 360 degrees, distance [radius, radius + offset*2]
-            this->asteroids.push_back(GenerateAsteroid(glm::vec3(0.0f), spawnRadius, despawnRadius, this->ySpan, model, texs));
+        this->asteroids.reserve(amount);
+        for (const auto& mesh : model->meshes) {
+            this->meshCenters.push_back(mesh.Center);
+            this->meshRadii.push_back(mesh.Radius);
+        }
+        // Initial cells around the origin, all merged before the first frame
+        RequestCells(glm::vec3(0.0f));
+        this->jobs->Wait(this->cellJobs);
+        MergeCells(glm::vec3(0.0f), this->maxAsteroids);
+        SetupInstanceBatches();
+        RefreshTransforms();
+        RebuildBroadphase();
+        BuildInstances();
+    }
+
+    // Generation jobs write into cells owned by this object, so they must finish first
+    ~AsteroidField() {
+        this->jobs->Wait(this->cellJobs);
+    }
+
+    AsteroidField(const AsteroidField&) = delete;
+    AsteroidField& operator=(const AsteroidField&) = delete;
+
+    // Distance from p to the closest point of a cell's column, which spans
+    // the small asteroids' vertical spread
+    static float CellDistance(glm::ivec3 cell, glm::vec3 p) {
+        const float halfHeight = ASTEROID_Y_SPREAD * 5.0f;
+        glm::vec3 lo = glm::vec3(cell.x * ASTEROID_CELL_SIZE, -halfHeight, cell.z * ASTEROID_CELL_SIZE);
+        glm::vec3 hi = lo + glm::vec3(ASTEROID_CELL_SIZE, 2.0f * halfHeight, ASTEROID_CELL_SIZE);
+        glm::vec3 d = glm::max(glm::max(lo - p, p - hi), glm::vec3(0.0f));
+        return glm::length(d);
+    }
+
+    // Queues every cell within spawnRadius of p that isn't loaded yet. The
+    // cells are generated by background jobs, never on the calling thread.
+    void RequestCells(glm::vec3 p) {
+        glm::ivec3 center = AsteroidCellCoord(p);
+        int reach = (int)std::ceil(this->spawnRadius / ASTEROID_CELL_SIZE);
+        for (int x = -reach; x <= reach; x++)
+            for (int z = -reach; z <= reach; z++) {
+                glm::ivec3 coord(center.x + x, 0, center.z + z);
+                if (CellDistance(coord, p) > this->spawnRadius) continue;
+                std::unique_ptr<AsteroidCell>& slot = this->cells[AsteroidCellKey(coord)];
+                if (slot) continue;
+                slot.reset(new AsteroidCell());
+                AsteroidCell* cell = slot.get();
+                cell->coord = coord;
+                cell->ready.store(false);
+                cell->mergedCount = 0;
+                this->cellJobs.fetch_add(1);
+                this->jobs->SubmitBackground([this, cell]() {
+                    GenerateAsteroidCell(this->seed, cell->coord, this->asteroidModel, this->textureLayers, cell->asteroids);
+                    cell->ready.store(true, std::memory_order_release);
+                }, &this->cellJobs);
+            }
+    }
+
+    // Copies generated cells into the field, at most `budget` asteroids per
+    // call; a cell larger than what is left of the budget goes on in the next
+    // call. A cell only starts once all of it fits under maxAsteroids next to
+    // the rest of the cells already started; until then it waits.
+    void MergeCells(glm::vec3 playerPos, size_t budget) {
+        AsteroidStore& store = this->asteroids;
+        size_t reserved = store.size();
+        for (auto& entry : this->cells) {
+            const AsteroidCell& cell = *entry.second;
+            if (cell.mergedCount > 0)
+                reserved += cell.asteroids.size() - cell.mergedCount;
+        }
+
+        size_t added = 0;
+        for (auto& entry : this->cells) {
+            if (added >= budget) break;
+            AsteroidCell& cell = *entry.second;
+            if (!cell.ready.load(std::memory_order_acquire)) continue;
+            size_t n = cell.asteroids.size();
+            if (cell.mergedCount == n) continue;
+            if (cell.mergedCount == 0) {
+                if (reserved + n > this->maxAsteroids) continue;
+                reserved += n;
+            }
+            size_t end = std::min(n, cell.mergedCount + (budget - added));
+            for (size_t k = cell.mergedCount; k < end; k++) {
+                store.PushFrom(cell.asteroids, k);
+                AimAtPlayer(store.size() - 1, playerPos);
+            }
+            added += end - cell.mergedCount;
+            cell.mergedCount = end;
         }
     }
 
-    int CheckAsteroidCollision(glm::vec3 playerPos, float playerRadius) {
+    // Unloads every finished cell farther than despawnRadius from p. Its
+    // asteroids that are still past despawnRadius go with it; the ones that
+    // drifted toward p stay, detached from the cell. Cells still being
+    // generated are dropped on a later frame.
+    void DropCells(glm::vec3 p) {
+        this->droppedCells.clear();
+        for (auto it = this->cells.begin(); it != this->cells.end();) {
+            AsteroidCell& cell = *it->second;
+            if (CellDistance(cell.coord, p) > this->despawnRadius && cell.ready.load(std::memory_order_acquire)) {
+                if (cell.mergedCount > 0)
+                    this->droppedCells.push_back(it->first);
+                it = this->cells.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (this->droppedCells.empty()) return;
+
+        std::sort(this->droppedCells.begin(), this->droppedCells.end());
+        const std::vector<uint64_t>& dropped = this->droppedCells;
+        AsteroidStore& store = this->asteroids;
+        float despawnRadius2 = this->despawnRadius * this->despawnRadius;
+        store.RemoveIf([&](size_t i) {
+            if (!std::binary_search(dropped.begin(), dropped.end(), AsteroidOriginCell(store.origin[i])))
+                return false;
+            float dx = store.posX[i] - p.x;
+            float dy = store.posY[i] - p.y;
+            float dz = store.posZ[i] - p.z;
+            if (dx * dx + dy * dy + dz * dz > despawnRadius2)
+                return true;
+            // RemoveIf reads element i before moving it, so this is kept
+            store.origin[i] = ASTEROID_ORIGIN_DETACHED;
+            return false;
+        });
+    }
+
+    // Medium and large asteroids fly toward the player (with the generated
+    // direction as a small deviation), as the cone respawn used to do
+    void AimAtPlayer(size_t i, glm::vec3 playerPos) {
+        AsteroidStore& store = this->asteroids;
+        if (store.type[i] == SMALL) return;
+        glm::vec3 vel(store.velX[i], store.velY[i], store.velZ[i]);
+        glm::vec3 toPlayer = playerPos - store.Position(i);
+        float speed = glm::length(vel);
+        if (speed < 0.001f || glm::length(toPlayer) < 0.001f) return;
+        vel = glm::normalize(glm::normalize(toPlayer) + vel / speed * 0.1f) * speed;
+        store.velX[i] = vel.x; store.velY[i] = vel.y; store.velZ[i] = vel.z;
+    }
+
+    // Puts every mesh (all LODs) and the impostor quad in the geometry arena,
+    // then creates one batch per (mesh, LOD) and the VAO they all draw with
+    void SetupInstanceBatches() {
+        const std::vector<Mesh>& meshes = asteroidModel->meshes;
+        std::vector<GeometryRange> meshRanges;
+        this->geometry.AddModel(*asteroidModel, meshRanges);
+        std::vector<Vertex> quad(4);
+        for (int k = 0; k < 4; k++)
+            quad[k].Position = glm::vec3(IMPOSTOR_QUAD[2 * k], IMPOSTOR_QUAD[2 * k + 1], 0.0f);
+        std::vector<unsigned int> quadIndices(IMPOSTOR_QUAD_INDICES, IMPOSTOR_QUAD_INDICES + 6);
+        this->impostorQuad = this->geometry.Add(quad, quadIndices);
+        this->geometry.Upload();
+
+        this->batches.clear();
+        this->meshBatchStart.clear();
+        for (size_t meshIdx = 0; meshIdx < meshes.size(); ++meshIdx) {
+            this->meshBatchStart.push_back(this->batches.size());
+            size_t lodCount = std::min<size_t>(meshes[meshIdx].Lods.size(), ASTEROID_LOD_LEVELS);
+            for (size_t lod = 0; lod < lodCount; lod++) {
+                this->batches.push_back(InstanceBatch());
+                InstanceBatch& batch = this->batches.back();
+                batch.meshIndex = (int)meshIdx;
+                batch.baseVertex = meshRanges[meshIdx].baseVertex;
+                batch.indexOffset = meshRanges[meshIdx].firstIndex + meshes[meshIdx].Lods[lod].indexOffset;
+                batch.indexCount = meshes[meshIdx].Lods[lod].indexCount;
+                batch.firstInstance = 0;
+                batch.instanceCount = 0;
+                batch.visibleCount = 0;
+            }
+        }
+        this->meshBatchStart.push_back(this->batches.size());
+
+        this->instanceBuffer.Init(this->maxAsteroids * sizeof(AsteroidInstance));
+        glGenVertexArrays(1, &this->VAO);
+        GLState().BindVertexArray(this->VAO);
+        this->geometry.BindVertexAttributes();
+        EnableInstanceAttributes();
+        SetInstanceSource(this->instanceBuffer.VBO, 0);
+        GLState().BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void RefreshTransforms() {
+        this->jobs->ParallelFor(this->asteroids.size(), ASTEROID_JOB_GRAIN, [this](size_t begin, size_t end) {
+            this->asteroids.RefreshTransforms(this->meshCenters, this->meshRadii, begin, end);
+        });
+    }
+
+    // Re-bins every hitable asteroid using the cached world bounds
+    void RebuildBroadphase() {
+        this->broadphase.Clear();
         for (size_t i = 0; i < this->asteroids.size(); i++) {
-            Asteroid& ast = this->asteroids[i];
-            
             // Only Medium and Large asteroids have hitboxes/collision
-            if (!ast.hitable) continue;
-            if (ast.Type == SMALL) continue; // Extra safety check
-
-            // Calculate World Radius of the asteroid
-            float astWorldRadius = ast.LocalRadius * ast.Scale;
-
-            // Calculate World Center correctly using the transformation matrix
-            // This ensures the hitbox matches the visual mesh even if the mesh is offset or rotated
-            glm::mat4 modelMatrix = glm::mat4(1.0f);
-            modelMatrix = glm::translate(modelMatrix, ast.Position);
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(ast.Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(ast.Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(ast.Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-            modelMatrix = glm::scale(modelMatrix, glm::vec3(ast.Scale));
-            
-            glm::vec3 astWorldCenter = glm::vec3(modelMatrix * glm::vec4(ast.LocalCenter, 1.0f));
-
-            // Reduce the hitbox slightly (0.85) to be forgiving to the player
-            float distance = glm::distance(playerPos, astWorldCenter);
-            if (distance < (playerRadius + astWorldRadius * 0.75f)) {
-                return (int)i; // Return index of the asteroid hit
-            }
+            if (!this->asteroids.hitable[i] || this->asteroids.type[i] == SMALL) continue;
+            this->broadphase.Insert((uint32_t)i, this->asteroids.BoundCenter(i), this->asteroids.boundRadius[i]);
         }
-        return -1; // No collision
+        this->broadphase.Build();
     }
 
-    void UpdateAsteroidField(float deltaTime, glm::vec3 playerPos, glm::vec3 playerDir, float currentTime) {
-        for (auto& asteroid : this->asteroids) {
-            asteroid.Update(deltaTime);
+    // Enables the AsteroidInstance attributes (locations 5..8, divisor 1) on the bound VAO
+    static void EnableInstanceAttributes() {
+        for (GLuint location = 5; location <= 8; location++) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
         }
+    }
+
+    // Points the instance attributes of the bound VAO at `buffer`, starting at
+    // record `first`. This is how one VAO draws each batch's range.
+    static void SetInstanceSource(unsigned int buffer, size_t first) {
+        GLsizei stride = sizeof(AsteroidInstance);
+        size_t base = first * sizeof(AsteroidInstance);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(AsteroidInstance, position)));
+        glVertexAttribPointer(6, 4, GL_SHORT, GL_TRUE, stride, (void*)(base + offsetof(AsteroidInstance, orientation)));
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, stride, (void*)(base + offsetof(AsteroidInstance, layer)));
+        glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, stride, (void*)(base + offsetof(AsteroidInstance, mesh)));
+    }
+
+    // Creates the transform feedback targets. cullShader must be built from
+    // asteroid_cull_vertex/geometry.glsl with the AsteroidInstance fields as
+    // interleaved varyings.
+    void EnableGpuCulling(Shader& cullShader) {
+        this->cullShader = &cullShader;
+        this->cullUniforms = AsteroidCullUniforms(cullShader);
 
-        // Lifecycle Check (Once per second)
-        if (currentTime - this->lastSpawnCheckTime > 1.0f) {
-            this->lastSpawnCheckTime = currentTime;
+        // Culling input: the instance buffer read as points, with the
+        // orientation as raw int16 so it is copied through unchanged
+        glGenVertexArrays(1, &this->cullVAO);
+        GLState().BindVertexArray(this->cullVAO);
+        this->instanceBuffer.Bind();
+        GLsizei stride = sizeof(AsteroidInstance);
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AsteroidInstance, position));
+        glEnableVertexAttribArray(6);
+        glVertexAttribIPointer(6, 4, GL_SHORT, stride, (void*)offsetof(AsteroidInstance, orientation));
+        glEnableVertexAttribArray(7);
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(AsteroidInstance, layer));
+        glEnableVertexAttribArray(8);
+        glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(AsteroidInstance, mesh));
+        GLState().BindVertexArray(0);
 
-            // Remove far asteroids
-            auto it = std::remove_if(this->asteroids.begin(), this->asteroids.end(), 
-                [&](const Asteroid& a) {
-                    return glm::distance(a.Position, playerPos) > this->despawnRadius;
-                });
-            this->asteroids.erase(it, this->asteroids.end());
-            // Spawn new ones if needed
-            while (this->asteroids.size() < this->maxAsteroids) {
-                // Spawn strictly between spawnRadius and despawnRadius (minus buffer)
-                // And in the direction the player is facing
-                this->asteroids.push_back(GenerateAsteroid(playerPos, this->spawnRadius, this->despawnRadius, this->ySpan, this->asteroidModel, this->textures, playerDir));
+        glGenBuffers(2, this->culledBuffers);
+        for (int k = 0; k < 2; k++) {
+            this->culledCapacity[k] = std::max<size_t>(this->maxAsteroids, 1) * sizeof(AsteroidInstance);
+            glBindBuffer(GL_ARRAY_BUFFER, this->culledBuffers[k]);
+            glBufferData(GL_ARRAY_BUFFER, this->culledCapacity[k], NULL, GL_DYNAMIC_COPY);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (InstanceBatch& batch : this->batches) {
+            for (CulledInstances& out : batch.culled) {
+                out.first = 0;
+                out.inputCount = 0;
+                out.pending = false;
+                glGenQueries(1, &out.query);
             }
+            batch.visibleCount = 0;
         }
     }
 
-    // Instanced rendering for all asteroids
-    void DrawAsteroidFieldInstanced(Shader& shader) {
-        shader.setBool("isUnlit", false);
+    // Draws asteroids as impostors once they are farther than distance and
+    // no bigger on screen than a tile (see SelectLod). shader is
+    // asteroid_impostor_vertex/fragment.glsl; atlas must already be baked.
+    void EnableImpostors(const ImpostorAtlas& atlas, Shader& shader, float distance) {
+        this->impostorAtlas = &atlas;
+        this->impostorShader = &shader;
+        this->impostorDistance = distance;
+    }
+
+    // Switching back to the GPU path must not draw a result left over from the
+    // last time it was on
+    void SetGpuCulling(bool enabled) {
+        if (enabled && !this->gpuCulling)
+            for (InstanceBatch& batch : this->batches)
+                for (CulledInstances& out : batch.culled)
+                    out.pending = false;
+        this->gpuCulling = enabled;
+    }
+
+    bool UsingGpuCulling() const {
+        return this->gpuCulling && this->cullShader && this->hasView;
+    }
+
+    // Creates the GL 4.5 path's buffers and VAO with direct state access.
+    // computeShader is asteroid_indirect_compute.glsl. Without a 4.5 context
+    // (GL45() not loaded) this does nothing and the 3.3 paths stay in use.
+    void EnableIndirectDraw(Shader& computeShader) {
+        if (!GL45().loaded) return;
+        GL45Functions& gl = GL45();
+        this->indirectShader = &computeShader;
+        this->indirectUniforms = AsteroidCullUniforms(computeShader);
+        this->streamCapacity = std::max<size_t>(this->maxAsteroids, 1);
+        size_t slotBytes = this->streamCapacity * sizeof(AsteroidInstance);
+
+        // Mapped once for the lifetime of the field; the fences in
+        // DrawIndirect keep the CPU off slots the GPU still reads
+        GLbitfield streamFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gl.CreateBuffers(1, &this->streamBuffer);
+        gl.NamedBufferStorage(this->streamBuffer, slotBytes * ASTEROID_FRAMES_IN_FLIGHT, NULL, streamFlags);
+        this->streamData = (AsteroidInstance*)gl.MapNamedBufferRange(this->streamBuffer, 0, slotBytes * ASTEROID_FRAMES_IN_FLIGHT, streamFlags);
+
+        // One command per batch, then one for the impostor quad. Command c
+        // draws region c of sortedBuffer, selected by its baseInstance.
+        this->commands.clear();
+        for (size_t b = 0; b <= this->batches.size(); b++) {
+            DrawElementsIndirectCommand command;
+            if (b < this->batches.size()) {
+                command.count = this->batches[b].indexCount;
+                command.firstIndex = this->batches[b].indexOffset;
+                command.baseVertex = this->batches[b].baseVertex;
+            } else {
+                command.count = this->impostorQuad.indexCount;
+                command.firstIndex = this->impostorQuad.firstIndex;
+                command.baseVertex = this->impostorQuad.baseVertex;
+            }
+            command.instanceCount = 0;
+            command.baseInstance = (GLuint)(b * this->streamCapacity);
+            this->commands.push_back(command);
+        }
+        size_t commandBytes = this->commands.size() * sizeof(DrawElementsIndirectCommand);
+        gl.CreateBuffers(1, &this->sortedBuffer);
+        gl.NamedBufferStorage(this->sortedBuffer, slotBytes * this->commands.size(), NULL, 0);
+        gl.CreateBuffers(1, &this->commandBuffer);
+        gl.NamedBufferStorage(this->commandBuffer, commandBytes, this->commands.data(), GL_DYNAMIC_STORAGE_BIT);
+        GLbitfield statsFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gl.CreateBuffers(1, &this->statsBuffer);
+        gl.NamedBufferStorage(this->statsBuffer, commandBytes * ASTEROID_FRAMES_IN_FLIGHT, NULL, statsFlags);
+        this->statsData = (const DrawElementsIndirectCommand*)gl.MapNamedBufferRange(this->statsBuffer, 0, commandBytes * ASTEROID_FRAMES_IN_FLIGHT, statsFlags);
+
+        // Arena geometry on binding 0, the sorted instances on binding 1
+        unsigned int vao;
+        gl.CreateVertexArrays(1, &vao);
+        this->indirectVAO = vao;
+        this->geometry.SetVertexAttributes(vao, 0);
+        gl.VertexArrayVertexBuffer(vao, 1, this->sortedBuffer, 0, sizeof(AsteroidInstance));
+        gl.VertexArrayBindingDivisor(vao, 1, 1);
+        gl.VertexArrayAttribFormat(vao, 5, 4, GL_FLOAT, GL_FALSE, offsetof(AsteroidInstance, position));
+        gl.VertexArrayAttribFormat(vao, 6, 4, GL_SHORT, GL_TRUE, offsetof(AsteroidInstance, orientation));
+        gl.VertexArrayAttribIFormat(vao, 7, 1, GL_UNSIGNED_INT, offsetof(AsteroidInstance, layer));
+        gl.VertexArrayAttribIFormat(vao, 8, 1, GL_UNSIGNED_INT, offsetof(AsteroidInstance, mesh));
+        for (GLuint location = 5; location <= 8; location++) {
+            gl.EnableVertexArrayAttrib(vao, location);
+            gl.VertexArrayAttribBinding(vao, location, 1);
+        }
 
-        // For each mesh in the model, draw all asteroids that use it
-        for (size_t meshIdx = 0; meshIdx < asteroidModel->meshes.size(); ++meshIdx) {
-            // Collect model matrices for asteroids using this mesh
-            std::vector<glm::mat4> meshModelMatrices;
-            for (const auto& asteroid : this->asteroids) {
-                if (asteroid.MeshIndex == (int)meshIdx) {
-                    meshModelMatrices.push_back(asteroid.GetModelMatrix());
+        // Batch layout and LOD thresholds never change
+        computeShader.use();
+        int meshCount = std::min((int)this->meshBatchStart.size() - 1, ASTEROID_INDIRECT_MAX_MESHES);
+        computeShader.setInt("meshCount", meshCount);
+        std::vector<int> batchStart(this->meshBatchStart.begin(), this->meshBatchStart.begin() + meshCount + 1);
+        computeShader.setIntArray(computeShader.handle("meshBatchStart"), batchStart.data(), meshCount + 1);
+        if (meshCount > 0) {
+            computeShader.setVec3Array(computeShader.handle("meshCenters"), this->meshCenters.data(), meshCount);
+            computeShader.setFloatArray(computeShader.handle("meshRadii"), this->meshRadii.data(), meshCount);
+        }
+        computeShader.setFloatArray(computeShader.handle("lodPixels"), ASTEROID_LOD_PIXELS, ASTEROID_LOD_LEVELS - 1);
+        computeShader.setInt("impostorCommand", (int)this->batches.size());
+    }
+
+    void SetIndirectDraw(bool enabled) {
+        this->indirectDraw = enabled;
+    }
+
+    bool UsingIndirectDraw() const {
+        return this->indirectDraw && this->indirectShader && this->hasView;
+    }
+
+    AsteroidInstance MakeInstance(size_t i) const {
+        const AsteroidStore& store = this->asteroids;
+        AsteroidInstance inst;
+        inst.position = store.Position(i);
+        inst.scale = store.scale[i];
+        inst.orientation[0] = PackSnorm16(store.quatX[i]);
+        inst.orientation[1] = PackSnorm16(store.quatY[i]);
+        inst.orientation[2] = PackSnorm16(store.quatZ[i]);
+        inst.orientation[3] = PackSnorm16(store.quatW[i]);
+        inst.layer = store.textureLayer[i];
+        inst.mesh = (uint32_t)store.meshIndex[i];
+        return inst;
+    }
+
+    // Camera used to cull the instances built by the next update
+    // projection[1][1] and viewportHeight give the screen size used for LOD selection
+    void SetView(const glm::mat4& projection, const glm::mat4& viewMatrix, float viewportHeight,
+                 glm::vec3 eye, float maxDistance, const Cone& lightCone) {
+        this->view.frustum = Frustum::FromMatrix(projection * viewMatrix);
+        this->view.lodScale = projection[1][1] * viewportHeight * 0.5f;
+        this->view.eye = eye;
+        this->view.maxDistance = maxDistance;
+        this->view.lightCone = lightCone;
+        this->hasView = true;
+    }
+
+    // Culls asteroids [begin, end) against the view into visible[].
+    // The GPU culling path still uses it for impostors, which it doesn't cull.
+    void CullRange(size_t begin, size_t end) {
+        const AsteroidStore& store = this->asteroids;
+        if (!this->hasView) {
+            std::fill(this->visible.begin() + begin, this->visible.begin() + end, 1);
+            return;
+        }
+        float eye[3] = { this->view.eye.x, this->view.eye.y, this->view.eye.z };
+        CullSpheres(&this->view.frustum.Planes[0].x, eye, this->view.maxDistance,
+                    store.boundX.data() + begin, store.boundY.data() + begin, store.boundZ.data() + begin,
+                    store.boundRadius.data() + begin, this->visible.data() + begin, end - begin);
+        for (size_t i = begin; i < end; i++) {
+            unsigned char f = this->visible[i];
+            bool show = (f & CULL_IN_FRUSTUM) &&
+                        ((f & CULL_IN_RANGE) || this->view.lightCone.IntersectsSphere(store.BoundCenter(i), store.boundRadius[i]));
+            this->visible[i] = show ? 1 : 0;
+        }
+    }
+
+    // LOD for asteroid i from the screen-space radius of its bounding sphere,
+    // or -1 when its mesh is in the atlas, it is past impostorDistance and it
+    // is small enough on screen that its tile isn't magnified
+    int SelectLod(size_t i, size_t lodCount) const {
+        if (!this->hasView) return 0;
+        const AsteroidStore& store = this->asteroids;
+        float dx = store.boundX[i] - this->view.eye.x;
+        float dy = store.boundY[i] - this->view.eye.y;
+        float dz = store.boundZ[i] - this->view.eye.z;
+        float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 0.001f);
+        float pixels = store.boundRadius[i] * this->view.lodScale / distance;
+        if (this->impostorAtlas && distance > this->impostorDistance &&
+            pixels <= this->impostorAtlas->MaxScreenRadius() &&
+            store.meshIndex[i] < this->impostorAtlas->meshCount)
+            return -1;
+        size_t lod = 0;
+        while (lod + 1 < lodCount && pixels < ASTEROID_LOD_PIXELS[lod])
+            lod++;
+        return (int)lod;
+    }
+
+    // Buckets the instance records of the visible asteroids by mesh and LOD,
+    // plus one bucket for impostors, back to back in `instances`. Each chunk
+    // culls and counts its asteroids per bucket, a prefix sum turns the counts
+    // into write offsets, and the chunks then scatter their records in parallel.
+    // With GPU culling only impostors are culled here; the mesh batches get
+    // every asteroid and the culling pass drops the invisible ones.
+    void BuildInstances() {
+        size_t count = this->asteroids.size();
+        if (UsingIndirectDraw()) {
+            // Unculled and unsorted: the compute pass does both. MergeCells
+            // keeps count under maxAsteroids, so the slot is big enough.
+            AsteroidInstance* out = this->streamData + this->streamSlot * this->streamCapacity;
+            this->jobs->ParallelFor(count, ASTEROID_JOB_GRAIN, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    out[i] = MakeInstance(i);
+            });
+            this->streamCount[this->streamSlot] = count;
+            return;
+        }
+        size_t meshCount = this->meshBatchStart.size() - 1;
+        size_t impostorBucket = this->batches.size();
+        size_t bucketCount = impostorBucket + 1;
+        size_t chunks = (count + ASTEROID_JOB_GRAIN - 1) / ASTEROID_JOB_GRAIN;
+        bool gpuCulled = UsingGpuCulling();
+        this->chunkOffsets.assign(chunks * bucketCount, 0);
+        this->visible.resize(count);
+        this->batchOf.resize(count);
+
+        this->jobs->ParallelFor(chunks, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+            for (size_t c = chunkBegin; c < chunkEnd; c++) {
+                size_t begin = c * ASTEROID_JOB_GRAIN;
+                size_t end = std::min(begin + ASTEROID_JOB_GRAIN, count);
+                CullRange(begin, end);
+                for (size_t i = begin; i < end; i++) {
+                    int meshIdx = this->asteroids.meshIndex[i];
+                    this->batchOf[i] = -1;
+                    if (meshIdx >= (int)meshCount) continue;
+                    size_t first = this->meshBatchStart[meshIdx];
+                    int lod = SelectLod(i, this->meshBatchStart[meshIdx + 1] - first);
+                    if (!this->visible[i] && (lod < 0 || !gpuCulled)) continue;
+                    size_t b = lod < 0 ? impostorBucket : first + lod;
+                    this->batchOf[i] = (int)b;
+                    this->chunkOffsets[c * bucketCount + b]++;
                 }
             }
-            if (meshModelMatrices.empty()) continue;
-
-            // Setup instance buffer
-            unsigned int instanceVBO;
-            glGenBuffers(1, &instanceVBO);
-            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-            glBufferData(GL_ARRAY_BUFFER, meshModelMatrices.size() * sizeof(glm::mat4), &meshModelMatrices[0], GL_STATIC_DRAW);
-
-            unsigned int VAO = asteroidModel->meshes[meshIdx].VAO;
-            glBindVertexArray(VAO);
-            std::size_t vec4Size = sizeof(glm::vec4);
-            for (unsigned int i = 0; i < 4; i++) {
-                glEnableVertexAttribArray(5 + i);
-                glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * vec4Size));
-                glVertexAttribDivisor(5 + i, 1);
+        });
+
+        size_t offset = 0;
+        for (size_t b = 0; b < bucketCount; b++) {
+            size_t first = offset;
+            for (size_t c = 0; c < chunks; c++) {
+                size_t n = this->chunkOffsets[c * bucketCount + b];
+                this->chunkOffsets[c * bucketCount + b] = offset;
+                offset += n;
+            }
+            if (b < impostorBucket) {
+                this->batches[b].firstInstance = first;
+                this->batches[b].instanceCount = offset - first;
+            } else {
+                this->impostorFirst = first;
+                this->impostorCount = offset - first;
             }
+        }
+        this->instances.resize(offset);
+        // The GPU path replaces these with its query results when it draws
+        this->drawnCount = offset;
+        this->culledCount = count - offset;
+
+        this->jobs->ParallelFor(chunks, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+            for (size_t c = chunkBegin; c < chunkEnd; c++) {
+                size_t end = std::min((c + 1) * ASTEROID_JOB_GRAIN, count);
+                for (size_t i = c * ASTEROID_JOB_GRAIN; i < end; i++) {
+                    int b = this->batchOf[i];
+                    if (b >= 0)
+                        this->instances[this->chunkOffsets[c * bucketCount + b]++] = MakeInstance(i);
+                }
+            }
+        });
+    }
+
+    // Collects the index of every asteroid touching the player sphere into contacts.
+    // Only asteroids binned in the cells around the player are tested.
+    void CheckAsteroidCollision(glm::vec3 playerPos, float playerRadius, std::vector<int>& contacts) {
+        contacts.clear();
+        const AsteroidStore& store = this->asteroids;
+        this->broadphase.Query(playerPos, playerRadius, [&](uint32_t i) {
+            float dx = store.boundX[i] - playerPos.x;
+            float dy = store.boundY[i] - playerPos.y;
+            float dz = store.boundZ[i] - playerPos.z;
+            // Reduce the hitbox slightly (0.75) to be forgiving to the player
+            float reach = playerRadius + store.boundRadius[i] * 0.75f;
+            if (dx * dx + dy * dy + dz * dz < reach * reach)
+                contacts.push_back((int)i);
+        });
+    }
 
-            asteroidModel->meshes[meshIdx].BindTextures(shader, 0);
-            // Draw instanced
-            //std::cout << "Drawing " << meshModelMatrices.size() << " instances of mesh " << meshIdx << std::endl;
-            glDrawElementsInstanced(GL_TRIANGLES, asteroidModel->meshes[meshIdx].indices.size(), GL_UNSIGNED_INT, 0, meshModelMatrices.size());
+    // Advances the field one frame. Integration, transform refresh and instance
+    // building are split across the job system; the broadphase rebuild and the
+    // instance bucketing only depend on the refreshed transforms, so they run
+    // side by side.
+    void UpdateAsteroidField(float deltaTime, glm::vec3 playerPos) {
+        TaskGraph graph;
 
-            // Cleanup
-            glBindVertexArray(0);
-            glDeleteBuffers(1, &instanceVBO);
+        TaskGraph::TaskId integrate = graph.Add([&]() {
+            this->jobs->ParallelFor(this->asteroids.size(), ASTEROID_JOB_GRAIN, [&](size_t begin, size_t end) {
+                this->asteroids.Update(deltaTime, begin, end);
+            });
+        });
+
+        TaskGraph::TaskId lifecycle = graph.Add([&]() {
+            UpdateLifecycle(playerPos);
+        });
+
+        TaskGraph::TaskId transforms = graph.Add([&]() { RefreshTransforms(); });
+        TaskGraph::TaskId broadphaseTask = graph.Add([&]() { RebuildBroadphase(); });
+        TaskGraph::TaskId instances = graph.Add([&]() { BuildInstances(); });
+
+        graph.Precede(integrate, lifecycle);
+        graph.Precede(lifecycle, transforms);
+        graph.Precede(transforms, broadphaseTask);
+        graph.Precede(transforms, instances);
+        graph.Run(*this->jobs);
+    }
+
+    // Streams cells in and out around the player, and resets a bounded slice
+    // of asteroids that drifted away back to their generated state
+    void UpdateLifecycle(glm::vec3 playerPos) {
+        AsteroidStore& store = this->asteroids;
+        size_t budget = std::max<size_t>(1, (this->maxAsteroids + ASTEROID_DESPAWN_SLICES - 1) / ASTEROID_DESPAWN_SLICES);
+
+        // Asteroids past despawnRadius whose cell is still loaded go back to
+        // their starting point, once that point is out of sight. Detached
+        // ones have nowhere to go back to and are removed.
+        float despawnRadius2 = this->despawnRadius * this->despawnRadius;
+        float spawnRadius2 = this->spawnRadius * this->spawnRadius;
+        for (size_t checked = 0; checked < budget && !store.empty(); checked++) {
+            if (this->despawnCursor >= store.size())
+                this->despawnCursor = 0;
+            size_t i = this->despawnCursor++;
+            float dx = store.posX[i] - playerPos.x;
+            float dy = store.posY[i] - playerPos.y;
+            float dz = store.posZ[i] - playerPos.z;
+            if (dx * dx + dy * dy + dz * dz <= despawnRadius2) continue;
+            auto it = this->cells.find(AsteroidOriginCell(store.origin[i]));
+            if (it == this->cells.end()) {
+                store.RemoveAt(i);
+                this->despawnCursor = i; // the last asteroid moved into i
+                continue;
+            }
+            const AsteroidStore& generated = it->second->asteroids;
+            size_t k = AsteroidOriginIndex(store.origin[i]);
+            glm::vec3 home = generated.Position(k) - playerPos;
+            if (glm::dot(home, home) <= spawnRadius2) continue;
+            store.CopyFrom(i, generated, k);
+            AimAtPlayer(i, playerPos);
         }
+
+        DropCells(playerPos);
+        RequestCells(playerPos);
+        MergeCells(playerPos, budget);
+    }
+
+    // Every asteroid samples its own layer of the texture array, so one draw
+    // per mesh and LOD covers all textures
+    void BindTextureArray(Shader& shader) {
+        GLState().ActiveTexture(GL_TEXTURE0 + ASTEROID_TEXTURE_UNIT);
+        GLState().BindTexture(GL_TEXTURE_2D_ARRAY, this->textureArray);
+        GLState().ActiveTexture(GL_TEXTURE0);
+        shader.setInt("texture_array", ASTEROID_TEXTURE_UNIT);
+        shader.setBool("useTextureArray", true);
+    }
+
+    // Instanced rendering for all asteroids (instances are built by UpdateAsteroidField).
+    // One upload and one VAO for the whole field.
+    void DrawAsteroidFieldInstanced(Shader& shader) {
+        BindTextureArray(shader);
+        if (UsingIndirectDraw()) {
+            DrawIndirect(shader);
+            return;
+        }
+        this->instanceBuffer.Upload(this->instances.data(), this->instances.size() * sizeof(AsteroidInstance));
+        GLState().BindVertexArray(this->VAO);
+        if (UsingGpuCulling()) {
+            DrawGpuCulled(shader);
+        } else {
+            shader.setBool("isUnlit", false);
+            for (InstanceBatch& batch : this->batches) {
+                if (batch.instanceCount == 0) continue;
+                SetInstanceSource(this->instanceBuffer.VBO, batch.firstInstance);
+                DrawBatch(batch, batch.instanceCount);
+            }
+        }
+        DrawImpostors(shader);
+        GLState().BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Draws count instances of a batch from the current instance source (VAO bound)
+    static void DrawBatch(const InstanceBatch& batch, size_t count) {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT,
+                                          (void*)(batch.indexOffset * sizeof(unsigned int)),
+                                          (GLsizei)count, batch.baseVertex);
+    }
+
+    // All impostors in one instanced quad draw (VAO bound); shader is made current again after
+    void DrawImpostors(Shader& shader) {
+        if (!this->impostorAtlas || this->impostorCount == 0) return;
+
+        this->impostorShader->use();
+        this->impostorAtlas->BindTextures();
+        SetInstanceSource(this->instanceBuffer.VBO, this->impostorFirst);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, this->impostorQuad.indexCount, GL_UNSIGNED_INT,
+                                          (void*)(this->impostorQuad.firstIndex * sizeof(unsigned int)),
+                                          (GLsizei)this->impostorCount, this->impostorQuad.baseVertex);
+        shader.use();
+    }
+
+    // GPU path: draws what the previous frame's culling pass kept, then culls
+    // this frame's instances for the next one. The CPU only uploads the
+    // unculled instances and reads back one counter per batch.
+    // Called from DrawAsteroidFieldInstanced with the instances uploaded and the VAO bound.
+    void DrawGpuCulled(Shader& shader) {
+        unsigned int current = this->cullFrame & 1;
+        unsigned int previous = current ^ 1;
+        this->cullFrame++;
+
+        shader.setBool("isUnlit", false);
+        size_t drawn = 0, submitted = 0, skipped = this->asteroids.size() - this->impostorCount;
+        for (InstanceBatch& batch : this->batches) {
+            CulledInstances& out = batch.culled[previous];
+            if (out.pending) {
+                // Issued a frame ago, so this rarely waits on the GPU
+                GLuint written = 0;
+                glGetQueryObjectuiv(out.query, GL_QUERY_RESULT, &written);
+                batch.visibleCount = written;
+                out.pending = false;
+                submitted += out.inputCount;
+            } else {
+                batch.visibleCount = 0;
+            }
+            drawn += batch.visibleCount;
+            skipped -= batch.instanceCount;
+            if (batch.visibleCount == 0) continue;
+
+            SetInstanceSource(this->culledBuffers[previous], out.first);
+            DrawBatch(batch, batch.visibleCount);
+        }
+        // Culled on the GPU a frame ago, plus far asteroids culled on the CPU
+        this->drawnCount = drawn + this->impostorCount;
+        this->culledCount = submitted - drawn + skipped;
+
+        // The output buffer needs room for every instance in case all survive
+        size_t bytes = this->impostorFirst * sizeof(AsteroidInstance);
+        if (bytes > this->culledCapacity[current]) {
+            while (this->culledCapacity[current] < bytes) this->culledCapacity[current] *= 2;
+            glBindBuffer(GL_ARRAY_BUFFER, this->culledBuffers[current]);
+            glBufferData(GL_ARRAY_BUFFER, this->culledCapacity[current], NULL, GL_DYNAMIC_COPY);
+        }
+
+        // Culling pass: vertex shader tests each instance, geometry shader drops
+        // the invisible ones, transform feedback packs the rest
+        Shader& cull = *this->cullShader;
+        const AsteroidCullUniforms& uniforms = this->cullUniforms;
+        cull.use();
+        SetViewUniforms(cull, uniforms);
+
+        GLState().Enable(GL_RASTERIZER_DISCARD);
+        GLState().BindVertexArray(this->cullVAO);
+        for (InstanceBatch& batch : this->batches) {
+            CulledInstances& out = batch.culled[current];
+            size_t count = batch.instanceCount;
+            if (count == 0) continue;
+
+            cull.setVec3(uniforms.meshCenter, this->meshCenters[batch.meshIndex]);
+            cull.setFloat(uniforms.meshRadius, this->meshRadii[batch.meshIndex]);
+            // Output goes to the same slot as the input range, which it can't outgrow
+            glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->culledBuffers[current],
+                              batch.firstInstance * sizeof(AsteroidInstance), count * sizeof(AsteroidInstance));
+            glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, out.query);
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, (GLint)batch.firstInstance, (GLsizei)count);
+            glEndTransformFeedback();
+            glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+            out.first = batch.firstInstance;
+            out.inputCount = count;
+            out.pending = true;
+        }
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        GLState().Disable(GL_RASTERIZER_DISCARD);
+        GLState().BindVertexArray(this->VAO);
+        shader.use();
+    }
+
+    // Frustum, fog range and light cone of this frame; cull must be in use
+    void SetViewUniforms(Shader& cull, const AsteroidCullUniforms& uniforms) const {
+        cull.setVec4Array(uniforms.frustumPlanes, this->view.frustum.Planes, Frustum::PLANE_COUNT);
+        cull.setVec3(uniforms.eye, this->view.eye);
+        cull.setFloat(uniforms.maxDistance, this->view.maxDistance);
+        cull.setVec3(uniforms.coneApex, this->view.lightCone.Apex);
+        cull.setVec3(uniforms.coneDirection, this->view.lightCone.Direction);
+        cull.setFloat(uniforms.coneCos, this->view.lightCone.CosAngle);
+        cull.setFloat(uniforms.coneSin, this->view.lightCone.SinAngle);
+    }
+
+    // GL 4.5 path: culls this frame's ring slot with the compute pass, then
+    // draws every mesh and LOD with one glMultiDrawElementsIndirect and the
+    // impostors with a second one (they need their own program). The CPU
+    // never reads the counts back; the stats are those of an earlier frame.
+    void DrawIndirect(Shader& shader) {
+        GL45Functions& gl = GL45();
+        unsigned int slot = this->streamSlot;
+        size_t count = this->streamCount[slot];
+        GLsizei batchCount = (GLsizei)this->batches.size();
+        size_t commandBytes = this->commands.size() * sizeof(DrawElementsIndirectCommand);
+
+        // Instance counts back to zero; the compute pass adds to them
+        gl.NamedBufferSubData(this->commandBuffer, 0, commandBytes, this->commands.data());
+
+        Shader& cull = *this->indirectShader;
+        const AsteroidCullUniforms& uniforms = this->indirectUniforms;
+        cull.use();
+        cull.setInt(uniforms.firstInput, (int)(slot * this->streamCapacity));
+        cull.setInt(uniforms.inputCount, (int)count);
+        SetViewUniforms(cull, uniforms);
+        cull.setFloat(uniforms.lodScale, this->view.lodScale);
+        cull.setInt(uniforms.impostorMeshCount, this->impostorAtlas ? this->impostorAtlas->meshCount : 0);
+        cull.setFloat(uniforms.impostorDistance, this->impostorDistance);
+        cull.setFloat(uniforms.impostorPixels, this->impostorAtlas ? this->impostorAtlas->MaxScreenRadius() : 0.0f);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->streamBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->sortedBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->commandBuffer);
+        if (count > 0)
+            gl.DispatchCompute((GLuint)((count + 63) / 64), 1, 1);
+        gl.MemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        gl.CopyNamedBufferSubData(this->commandBuffer, this->statsBuffer, 0, slot * commandBytes, commandBytes);
+
+        shader.use();
+        shader.setBool("isUnlit", false);
+        GLState().BindVertexArray(this->indirectVAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+        gl.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, batchCount, 0);
+        if (this->impostorAtlas) {
+            this->impostorShader->use();
+            this->impostorAtlas->BindTextures();
+            gl.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                         (void*)(batchCount * sizeof(DrawElementsIndirectCommand)), 1, 0);
+            shader.use();
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        GLState().BindVertexArray(0);
+
+        // The next slot was last drawn ASTEROID_FRAMES_IN_FLIGHT - 1 frames
+        // ago. This blocks until its fence signals, which only takes time when
+        // the GPU is more than that many frames behind. Once it has,
+        // BuildInstances may overwrite it and its copied counts are final.
+        this->streamFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        this->streamSlot = (slot + 1) % ASTEROID_FRAMES_IN_FLIGHT;
+        GLsync& fence = this->streamFences[this->streamSlot];
+        if (!fence) return;
+        GLenum waited = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, ASTEROID_FENCE_TIMEOUT_NS);
+        if (waited == GL_TIMEOUT_EXPIRED || waited == GL_WAIT_FAILED)
+            std::cout << "ERROR::ASTEROID_FIELD:: Instance ring fence did not signal, reusing the slot anyway" << std::endl;
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        const DrawElementsIndirectCommand* done = this->statsData + this->streamSlot * this->commands.size();
+        size_t drawn = 0;
+        for (size_t c = 0; c < this->commands.size(); c++)
+            drawn += done[c].instanceCount;
+        this->drawnCount = drawn;
+        this->impostorCount = done[batchCount].instanceCount;
+        this->culledCount = this->streamCount[this->streamSlot] - drawn;
     }
 };
 
@@ -0,0 +1,272 @@
+#ifndef ASTEROID_STORE_H
+#define ASTEROID_STORE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "engine/simd.h"
+#include "engine/transform.h"
+#include "engine/random.h"
+#include "asteroid.h"
+
+// Structure-of-arrays storage for the asteroid field.
+// The per-frame integration only streams through the hot float arrays
+// (position, orientation and their velocities), so each cache line it touches is
+// fully used. Per-mesh data (local bounds) is looked up from the Model instead
+// of being copied into every asteroid.
+struct AsteroidStore {
+    // Hot: touched by Update every frame
+    AlignedFloats posX, posY, posZ;
+    AlignedFloats quatX, quatY, quatZ, quatW; // unit orientation quaternion
+    AlignedFloats velX, velY, velZ;
+    AlignedFloats angVelX, angVelY, angVelZ; // radians/s, world axes
+
+    // Cached once per frame by RefreshTransforms and shared by drawing and collision
+    std::vector<Affine3x4, AlignedAllocator<Affine3x4> > transforms;
+    AlignedFloats boundX, boundY, boundZ, boundRadius; // world-space bounding sphere
+
+    // Cold: read by collision and rendering
+    AlignedFloats scale;
+    std::vector<AsteroidType> type;
+    std::vector<int> meshIndex;
+    std::vector<unsigned int> textureLayer;
+    std::vector<unsigned char> hitable;
+    std::vector<uint64_t> origin; // AsteroidOrigin(cell, index in the cell)
+
+    size_t size() const { return posX.size(); }
+    bool empty() const { return posX.empty(); }
+
+    void reserve(size_t n) {
+        for (AlignedFloats* a : floatArrays()) a->reserve(n);
+        transforms.reserve(n);
+        type.reserve(n);
+        meshIndex.reserve(n);
+        textureLayer.reserve(n);
+        hitable.reserve(n);
+        origin.reserve(n);
+    }
+
+    // Grows or shrinks every array to n asteroids; new slots must be filled with Set
+    void Resize(size_t n) {
+        for (AlignedFloats* a : floatArrays()) a->resize(n);
+        transforms.resize(n);
+        type.resize(n);
+        meshIndex.resize(n);
+        textureLayer.resize(n);
+        hitable.resize(n);
+        origin.resize(n);
+    }
+
+    // Leaves origin untouched, the generator sets it
+    void Set(size_t i, const Asteroid& a) {
+        posX[i] = a.Position.x; posY[i] = a.Position.y; posZ[i] = a.Position.z;
+        quatX[i] = a.Orientation.x; quatY[i] = a.Orientation.y;
+        quatZ[i] = a.Orientation.z; quatW[i] = a.Orientation.w;
+        velX[i] = a.Velocity.x; velY[i] = a.Velocity.y; velZ[i] = a.Velocity.z;
+        angVelX[i] = a.AngularVelocity.x; angVelY[i] = a.AngularVelocity.y; angVelZ[i] = a.AngularVelocity.z;
+        scale[i] = a.Scale;
+        transforms[i] = Affine3x4::FromTRS(a.Position, a.Orientation, glm::vec3(a.Scale));
+        boundX[i] = a.Position.x; boundY[i] = a.Position.y; boundZ[i] = a.Position.z;
+        boundRadius[i] = 0.0f;
+        type[i] = a.Type;
+        meshIndex[i] = a.MeshIndex;
+        textureLayer[i] = a.TextureLayer;
+        hitable[i] = a.hitable ? 1 : 0;
+    }
+
+    void Push(const Asteroid& a) {
+        Resize(size() + 1);
+        Set(size() - 1, a);
+    }
+
+    // Appends a copy of asteroid i of another store
+    void PushFrom(const AsteroidStore& src, size_t i) {
+        std::array<AlignedFloats*, 18> dst = floatArrays();
+        std::array<const AlignedFloats*, 18> from = src.floatArrays();
+        for (size_t a = 0; a < dst.size(); a++) dst[a]->push_back((*from[a])[i]);
+        transforms.push_back(src.transforms[i]);
+        type.push_back(src.type[i]);
+        meshIndex.push_back(src.meshIndex[i]);
+        textureLayer.push_back(src.textureLayer[i]);
+        hitable.push_back(src.hitable[i]);
+        origin.push_back(src.origin[i]);
+    }
+
+    // Overwrites asteroid i with asteroid j of src (which may be this store)
+    void CopyFrom(size_t i, const AsteroidStore& src, size_t j) {
+        std::array<AlignedFloats*, 18> dst = floatArrays();
+        std::array<const AlignedFloats*, 18> from = src.floatArrays();
+        for (size_t a = 0; a < dst.size(); a++) (*dst[a])[i] = (*from[a])[j];
+        transforms[i] = src.transforms[j];
+        type[i] = src.type[j];
+        meshIndex[i] = src.meshIndex[j];
+        textureLayer[i] = src.textureLayer[j];
+        hitable[i] = src.hitable[j];
+        origin[i] = src.origin[j];
+    }
+
+    // Swap-and-pop: O(1), does not preserve order
+    void RemoveAt(size_t i) {
+        size_t last = size() - 1;
+        if (i != last)
+            CopyFrom(i, *this, last);
+        Resize(last);
+    }
+
+    // Removes every asteroid i for which remove(i) is true in one pass,
+    // keeping the order of the others
+    template <typename Pred>
+    void RemoveIf(Pred remove) {
+        size_t kept = 0;
+        for (size_t i = 0; i < size(); i++) {
+            if (remove(i)) continue;
+            if (kept != i)
+                CopyFrom(kept, *this, i);
+            kept++;
+        }
+        Resize(kept);
+    }
+
+    // Integrates position and orientation of asteroids [begin, end).
+    // Disjoint ranges can be updated from different threads.
+    void Update(float deltaTime, size_t begin, size_t end) {
+        if (end <= begin) return;
+        size_t n = end - begin;
+        AddScaled(posX.data() + begin, velX.data() + begin, deltaTime, n);
+        AddScaled(posY.data() + begin, velY.data() + begin, deltaTime, n);
+        AddScaled(posZ.data() + begin, velZ.data() + begin, deltaTime, n);
+        IntegrateQuaternions(quatX.data() + begin, quatY.data() + begin, quatZ.data() + begin, quatW.data() + begin,
+                             angVelX.data() + begin, angVelY.data() + begin, angVelZ.data() + begin, deltaTime, n);
+    }
+
+    void Update(float deltaTime) {
+        Update(deltaTime, 0, size());
+    }
+
+    // Rebuilds the cached world transforms and bounding spheres of asteroids [begin, end)
+    // from the per-mesh local bounds
+    void RefreshTransforms(const std::vector<glm::vec3>& meshCenters, const std::vector<float>& meshRadii, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            transforms[i] = Affine3x4::FromTRS(Position(i), Orientation(i), glm::vec3(scale[i]));
+            int m = meshIndex[i];
+            glm::vec3 c = transforms[i].TransformPoint(meshCenters[m]);
+            boundX[i] = c.x;
+            boundY[i] = c.y;
+            boundZ[i] = c.z;
+            boundRadius[i] = meshRadii[m] * scale[i];
+        }
+    }
+
+    void RefreshTransforms(const std::vector<glm::vec3>& meshCenters, const std::vector<float>& meshRadii) {
+        RefreshTransforms(meshCenters, meshRadii, 0, size());
+    }
+
+    glm::vec3 Position(size_t i) const {
+        return glm::vec3(posX[i], posY[i], posZ[i]);
+    }
+
+    glm::quat Orientation(size_t i) const {
+        return glm::quat(quatW[i], quatX[i], quatY[i], quatZ[i]);
+    }
+
+    glm::vec3 BoundCenter(size_t i) const {
+        return glm::vec3(boundX[i], boundY[i], boundZ[i]);
+    }
+
+private:
+    std::array<AlignedFloats*, 18> floatArrays() {
+        return { &posX, &posY, &posZ, &quatX, &quatY, &quatZ, &quatW,
+                 &velX, &velY, &velZ, &angVelX, &angVelY, &angVelZ,
+                 &boundX, &boundY, &boundZ, &boundRadius, &scale };
+    }
+
+    std::array<const AlignedFloats*, 18> floatArrays() const {
+        return { &posX, &posY, &posZ, &quatX, &quatY, &quatZ, &quatW,
+                 &velX, &velY, &velZ, &angVelX, &angVelY, &angVelZ,
+                 &boundX, &boundY, &boundZ, &boundRadius, &scale };
+    }
+};
+
+// Streaming cells: the field's plane (y = 0) is split into squares of
+// ASTEROID_CELL_SIZE, each a column holding the whole vertical spread, and
+// the asteroids of a cell are a pure function of (seed, cell coordinate).
+// Cell coordinates keep a y component, which is always 0.
+// Asteroid k of a cell uses the random stream AsteroidOrigin(cell, k); the two
+// streams above the asteroid range hold the cell's count and its region density.
+const float ASTEROID_CELL_SIZE = 100.0f;
+// About the old fixed pool's density: 2000 asteroids over the 200-300 unit
+// annulus around the player is ~127 per 100x100 square
+const int ASTEROID_CELL_MEAN_COUNT = 128;
+const int ASTEROID_CELL_MAX_COUNT = 1022;
+// Density is drawn per region of ASTEROID_REGION_CELLS x ASTEROID_REGION_CELLS
+// columns, so there are wide sparse and dense areas instead of per-cell noise
+const int ASTEROID_REGION_CELLS = 4;
+const int ASTEROID_CELL_BITS = 17;  // per axis, signed: +-65536 cells
+const int ASTEROID_INDEX_BITS = 10; // asteroid index inside the cell
+
+// Packs a cell coordinate into ASTEROID_CELL_BITS * 3 bits
+inline uint64_t AsteroidCellKey(glm::ivec3 cell) {
+    const uint64_t mask = (1ull << ASTEROID_CELL_BITS) - 1;
+    return ((uint64_t)(uint32_t)cell.x & mask) |
+           (((uint64_t)(uint32_t)cell.y & mask) << ASTEROID_CELL_BITS) |
+           (((uint64_t)(uint32_t)cell.z & mask) << (2 * ASTEROID_CELL_BITS));
+}
+
+inline glm::ivec3 AsteroidCellCoord(const glm::vec3& p) {
+    return glm::ivec3((int)std::floor(p.x / ASTEROID_CELL_SIZE),
+                      0,
+                      (int)std::floor(p.z / ASTEROID_CELL_SIZE));
+}
+
+// Random stream (and identity) of asteroid `index` of a cell
+inline uint64_t AsteroidOrigin(uint64_t cellKey, uint64_t index) {
+    return (cellKey << ASTEROID_INDEX_BITS) | index;
+}
+
+// Origin of an asteroid that outlived its cell (see AsteroidField::DropCells).
+// Its cell bits are above every cell key, so it never matches a loaded cell.
+const uint64_t ASTEROID_ORIGIN_DETACHED = ~0ull;
+
+inline uint64_t AsteroidOriginCell(uint64_t origin) {
+    return origin >> ASTEROID_INDEX_BITS;
+}
+
+inline size_t AsteroidOriginIndex(uint64_t origin) {
+    return (size_t)(origin & ((1ull << ASTEROID_INDEX_BITS) - 1));
+}
+
+// Density multiplier in [0.25, 1.75) of the region a cell belongs to
+inline float AsteroidRegionDensity(uint64_t seed, glm::ivec3 cell) {
+    glm::ivec3 region((int)std::floor(cell.x / (float)ASTEROID_REGION_CELLS),
+                      0,
+                      (int)std::floor(cell.z / (float)ASTEROID_REGION_CELLS));
+    Random rng(seed, AsteroidOrigin(AsteroidCellKey(region), ASTEROID_CELL_MAX_COUNT + 1));
+    return 0.25f + 1.5f * rng.NextFloat();
+}
+
+inline int AsteroidCellCount(uint64_t seed, glm::ivec3 cell) {
+    Random rng(seed, AsteroidOrigin(AsteroidCellKey(cell), ASTEROID_CELL_MAX_COUNT));
+    float mean = ASTEROID_CELL_MEAN_COUNT * AsteroidRegionDensity(seed, cell);
+    int count = (int)std::lround(mean * rng.Range(0.5f, 1.5f));
+    return std::min(count, ASTEROID_CELL_MAX_COUNT);
+}
+
+// Replaces the contents of out with the asteroids of a cell
+inline void GenerateAsteroidCell(uint64_t seed, glm::ivec3 cell, Model* model, int textureLayers, AsteroidStore& out) {
+    uint64_t key = AsteroidCellKey(cell);
+    int count = AsteroidCellCount(seed, cell);
+    glm::vec3 cellMin = glm::vec3(cell.x, cell.y, cell.z) * ASTEROID_CELL_SIZE;
+    out.Resize(count);
+    for (int k = 0; k < count; k++) {
+        Random rng(seed, AsteroidOrigin(key, k));
+        out.Set(k, GenerateAsteroidInCell(rng, cellMin, ASTEROID_CELL_SIZE, model, textureLayers));
+        out.origin[k] = AsteroidOrigin(key, k);
+    }
+}
+
+#endif
@@ -0,0 +1,571 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include "libs/glad.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "engine/gl_state.h"
+
+// A frame is described as passes that read and write render targets. Each
+// frame the graph:
+//  - orders the passes so every reader runs after the writers of what it reads,
+//  - drops passes whose results nothing reads (a pass writing the backbuffer
+//    is always kept),
+//  - maps the frame's transient textures onto a persistent pool, letting
+//    textures with the same description share one GL texture when their
+//    lifetimes don't overlap, so adding passes doesn't grow GPU memory,
+//  - binds each pass's FBO and times it with a GL_TIME_ELAPSED query.
+//
+// Typical use, once per frame:
+//
+//   frameGraph.Begin(width, height);
+//   FrameGraphResource depth = frameGraph.CreateTexture("depth", { width, height, GL_DEPTH24_STENCIL8 });
+//   int prepass = frameGraph.AddPass("depth prepass", [&]() { ... });
+//   frameGraph.Write(prepass, depth);
+//   ...
+//   frameGraph.Execute();
+
+typedef int FrameGraphResource;
+
+struct RenderTargetDesc {
+    int width;
+    int height;
+    GLenum format; // sized internal format, e.g. GL_RGBA16F or GL_DEPTH24_STENCIL8
+
+    bool operator==(const RenderTargetDesc& other) const
+    {
+        return width == other.width && height == other.height && format == other.format;
+    }
+};
+
+// GPU time of one pass, as measured QUERY_FRAMES frames ago
+struct FramePassTiming {
+    std::string name;
+    double milliseconds;
+};
+
+class FrameGraph
+{
+public:
+    typedef std::function<void()> ExecuteFn;
+
+    // Frames between issuing a timer query and reading it, so reads don't stall
+    static const int QUERY_FRAMES = 3;
+    // Pooled textures unused for this many frames are deleted (e.g. after a resize)
+    static const int EVICT_FRAMES = 120;
+
+    // Stats of the last Execute
+    size_t passCount;
+    size_t culledPassCount;
+    size_t transientCount; // textures the passes asked for
+    size_t physicalCount;  // GL textures backing them
+    std::vector<FramePassTiming> timings;
+
+    FrameGraph() : passCount(0), culledPassCount(0), transientCount(0), physicalCount(0),
+                   frame(0), width(0), height(0) {}
+
+    // Starts describing a frame rendered at width x height
+    void Begin(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        this->frame++;
+        this->passes.clear();
+        this->resources.clear();
+        // The default framebuffer is always resource 0
+        Resource backbuffer;
+        backbuffer.name = "backbuffer";
+        backbuffer.desc = RenderTargetDesc{ width, height, GL_NONE };
+        backbuffer.imported = true;
+        this->resources.push_back(backbuffer);
+        readTimings();
+    }
+
+    FrameGraphResource Backbuffer() const { return 0; }
+
+    // A texture that only lives during this frame
+    FrameGraphResource CreateTexture(const char* name, const RenderTargetDesc& desc)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        this->resources.push_back(resource);
+        return (FrameGraphResource)this->resources.size() - 1;
+    }
+
+    // Returns the pass index, for Read and Write
+    int AddPass(const char* name, ExecuteFn execute)
+    {
+        Pass pass;
+        pass.name = name;
+        pass.execute = std::move(execute);
+        this->passes.push_back(pass);
+        return (int)this->passes.size() - 1;
+    }
+
+    void Read(int pass, FrameGraphResource resource)
+    {
+        this->passes[pass].reads.push_back(resource);
+        this->resources[resource].readers.push_back(pass);
+    }
+
+    // Render targets are attached in Write order (depth formats go to the depth attachment)
+    void Write(int pass, FrameGraphResource resource)
+    {
+        this->passes[pass].writes.push_back(resource);
+        this->resources[resource].writers.push_back(pass);
+    }
+
+    // GL texture behind a transient resource; valid inside pass callbacks
+    GLuint Texture(FrameGraphResource resource) const
+    {
+        int p = this->resources[resource].physical;
+        return p >= 0 ? this->pool[p].texture : 0;
+    }
+
+    // Compiles the frame and runs the live passes in order
+    void Execute()
+    {
+        std::vector<int> order = sortPasses();
+        cullPasses();
+        allocateTargets(order);
+
+        QueryFrame& slot = this->queries[this->frame % QUERY_FRAMES];
+        size_t queryCount = 0;
+        this->passCount = 0;
+        for (int index : order) {
+            Pass& pass = this->passes[index];
+            if (pass.culled)
+                continue;
+            bindTargets(pass);
+
+            if (queryCount == slot.size()) {
+                PendingQuery q;
+                glGenQueries(1, &q.query);
+                slot.push_back(q);
+            }
+            PendingQuery& q = slot[queryCount++];
+            q.name = pass.name;
+            q.issued = true;
+            glBeginQuery(GL_TIME_ELAPSED, q.query);
+            pass.execute();
+            glEndQuery(GL_TIME_ELAPSED);
+            this->passCount++;
+        }
+        for (size_t i = queryCount; i < slot.size(); i++)
+            slot[i].issued = false;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, this->width, this->height);
+    }
+
+    // Deletes every GL object the graph owns
+    void Release()
+    {
+        for (auto& entry : this->framebuffers)
+            glDeleteFramebuffers(1, &entry.second);
+        this->framebuffers.clear();
+        for (Physical& p : this->pool)
+            GLState().DeleteTextures(1, &p.texture);
+        this->pool.clear();
+        for (QueryFrame& slot : this->queries) {
+            for (PendingQuery& q : slot)
+                glDeleteQueries(1, &q.query);
+            slot.clear();
+        }
+    }
+
+#ifndef NDEBUG
+    // Debug builds only: runs a few frames of a throwaway graph through
+    // culling, aliasing and eviction and checks the outcome. Needs a current
+    // GL context. Returns false (after logging what failed) on a mismatch.
+    static bool SelfTest()
+    {
+        bool ok = true;
+        auto check = [&ok](bool condition, const char* what) {
+            if (!condition) {
+                std::cout << "ERROR::FRAME_GRAPH:: Self-test failed: " << what << std::endl;
+                ok = false;
+            }
+        };
+        auto nothing = []() {};
+        const RenderTargetDesc small = { 4, 4, GL_RGBA8 };
+        const RenderTargetDesc large = { 8, 8, GL_RGBA8 };
+
+        // a -> ping -> b -> pong -> c -> ping2 -> d -> backbuffer, plus a
+        // pass whose target nothing reads. ping's lifetime ends before
+        // ping2's starts, so they should share a texture; pong overlaps both.
+        FrameGraph graph;
+        graph.Begin(small.width, small.height);
+        FrameGraphResource ping = graph.CreateTexture("ping", small);
+        FrameGraphResource pong = graph.CreateTexture("pong", small);
+        FrameGraphResource ping2 = graph.CreateTexture("ping2", small);
+        FrameGraphResource orphan = graph.CreateTexture("orphan", small);
+        int a = graph.AddPass("a", nothing);
+        graph.Write(a, ping);
+        int b = graph.AddPass("b", nothing);
+        graph.Read(b, ping);
+        graph.Write(b, pong);
+        int c = graph.AddPass("c", nothing);
+        graph.Read(c, pong);
+        graph.Write(c, ping2);
+        int d = graph.AddPass("d", nothing);
+        graph.Read(d, ping2);
+        graph.Write(d, graph.Backbuffer());
+        int unused = graph.AddPass("unused", nothing);
+        graph.Write(unused, orphan);
+        graph.Execute();
+        check(graph.passCount == 4 && graph.culledPassCount == 1, "the pass nothing reads was not culled");
+        check(graph.transientCount == 3 && graph.physicalCount == 2, "targets with disjoint lifetimes were not aliased");
+        check(graph.Texture(ping) == graph.Texture(ping2) && graph.Texture(ping) != graph.Texture(pong),
+              "aliased targets got the wrong textures");
+
+        // As after a resize: the small textures go unused until evicted
+        for (int frame = 0; frame < EVICT_FRAMES; frame++) {
+            graph.Begin(large.width, large.height);
+            FrameGraphResource color = graph.CreateTexture("color", large);
+            int write = graph.AddPass("write", nothing);
+            graph.Write(write, color);
+            int read = graph.AddPass("read", nothing);
+            graph.Read(read, color);
+            graph.Write(read, graph.Backbuffer());
+            graph.Execute();
+        }
+        check(graph.pool.size() == 1 && graph.pool[0].desc == large, "unused pooled textures were not evicted");
+        check(graph.framebuffers.size() == 1, "framebuffers of evicted textures were kept");
+
+        graph.Release();
+        return ok;
+    }
+#endif
+
+private:
+    struct Resource {
+        std::string name;
+        RenderTargetDesc desc;
+        bool imported;
+        std::vector<int> writers, readers;
+        int firstUse, lastUse; // positions in the execution order
+        int physical;          // index into pool
+
+        Resource() : imported(false), firstUse(-1), lastUse(-1), physical(-1) {}
+    };
+
+    struct Pass {
+        std::string name;
+        ExecuteFn execute;
+        std::vector<FrameGraphResource> reads, writes;
+        bool culled;
+
+        Pass() : culled(false) {}
+    };
+
+    struct Physical {
+        RenderTargetDesc desc;
+        GLuint texture;
+        int busyUntil;      // last execution position using it this frame
+        size_t lastFrame;   // last frame it backed a resource
+    };
+
+    struct PendingQuery {
+        std::string name;
+        GLuint query;
+        bool issued;
+
+        PendingQuery() : query(0), issued(false) {}
+    };
+    typedef std::vector<PendingQuery> QueryFrame;
+
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    std::vector<Physical> pool;
+    std::map<std::vector<GLuint>, GLuint> framebuffers; // attachments -> FBO
+    QueryFrame queries[QUERY_FRAMES];
+    size_t frame;
+    int width, height;
+
+    // Kahn's algorithm over writer -> reader edges (and writer -> later
+    // writer of the same target), taking the earliest declared pass whenever
+    // several are ready. Falls back to declaration order on a cycle.
+    std::vector<int> sortPasses() const
+    {
+        int count = (int)this->passes.size();
+        std::vector<std::vector<int>> next(count);
+        std::vector<int> incoming(count, 0);
+        for (const Resource& r : this->resources) {
+            for (size_t w = 0; w < r.writers.size(); w++) {
+                if (w + 1 < r.writers.size()) {
+                    next[r.writers[w]].push_back(r.writers[w + 1]);
+                    incoming[r.writers[w + 1]]++;
+                }
+                for (int reader : r.readers) {
+                    if (reader == r.writers[w])
+                        continue;
+                    next[r.writers[w]].push_back(reader);
+                    incoming[reader]++;
+                }
+            }
+        }
+
+        std::vector<int> order;
+        std::vector<int> ready;
+        for (int i = 0; i < count; i++)
+            if (incoming[i] == 0)
+                ready.push_back(i);
+        while (!ready.empty()) {
+            auto earliest = std::min_element(ready.begin(), ready.end());
+            int pass = *earliest;
+            ready.erase(earliest);
+            order.push_back(pass);
+            for (int n : next[pass])
+                if (--incoming[n] == 0)
+                    ready.push_back(n);
+        }
+        if ((int)order.size() != count) {
+            std::cout << "ERROR::FRAME_GRAPH:: Pass dependencies form a cycle, using declaration order" << std::endl;
+            order.clear();
+            for (int i = 0; i < count; i++)
+                order.push_back(i);
+        }
+        return order;
+    }
+
+    // A pass stays if it writes an imported target or something a live pass reads
+    void cullPasses()
+    {
+        std::vector<int> passRefs(this->passes.size());
+        std::vector<int> resourceRefs(this->resources.size());
+        std::vector<int> unreferenced;
+        for (size_t i = 0; i < this->passes.size(); i++)
+            passRefs[i] = (int)this->passes[i].writes.size();
+        for (size_t r = 0; r < this->resources.size(); r++) {
+            resourceRefs[r] = (int)this->resources[r].readers.size();
+            if (resourceRefs[r] == 0 && !this->resources[r].imported)
+                unreferenced.push_back((int)r);
+        }
+
+        while (!unreferenced.empty()) {
+            int r = unreferenced.back();
+            unreferenced.pop_back();
+            for (int writer : this->resources[r].writers) {
+                if (--passRefs[writer] > 0)
+                    continue;
+                this->passes[writer].culled = true;
+                for (FrameGraphResource read : this->passes[writer].reads)
+                    if (--resourceRefs[read] == 0 && !this->resources[read].imported)
+                        unreferenced.push_back(read);
+            }
+        }
+
+        // A pass that writes nothing has no visible effect either
+        this->culledPassCount = 0;
+        for (Pass& pass : this->passes) {
+            if (pass.writes.empty())
+                pass.culled = true;
+            if (pass.culled)
+                this->culledPassCount++;
+        }
+    }
+
+    // Gives each live transient a pooled texture nobody else uses during
+    // its lifetime, creating one only when none is free
+    void allocateTargets(const std::vector<int>& order)
+    {
+        for (size_t position = 0; position < order.size(); position++) {
+            const Pass& pass = this->passes[order[position]];
+            if (pass.culled)
+                continue;
+            for (const std::vector<FrameGraphResource>* list : { &pass.reads, &pass.writes })
+                for (FrameGraphResource r : *list) {
+                    Resource& resource = this->resources[r];
+                    if (resource.firstUse < 0)
+                        resource.firstUse = (int)position;
+                    resource.lastUse = (int)position;
+                }
+        }
+
+        std::vector<int> live;
+        for (size_t r = 1; r < this->resources.size(); r++)
+            if (this->resources[r].firstUse >= 0)
+                live.push_back((int)r);
+        std::sort(live.begin(), live.end(), [this](int a, int b) {
+            return this->resources[a].firstUse < this->resources[b].firstUse;
+        });
+
+        for (Physical& p : this->pool)
+            p.busyUntil = -1;
+        std::vector<bool> used(this->pool.size(), false);
+        for (int r : live) {
+            Resource& resource = this->resources[r];
+            int chosen = -1;
+            for (size_t p = 0; p < this->pool.size(); p++) {
+                if (this->pool[p].desc == resource.desc && this->pool[p].busyUntil < resource.firstUse) {
+                    chosen = (int)p;
+                    break;
+                }
+            }
+            if (chosen < 0) {
+                this->pool.push_back(createPhysical(resource.desc));
+                used.push_back(false);
+                chosen = (int)this->pool.size() - 1;
+            }
+            this->pool[chosen].busyUntil = resource.lastUse;
+            this->pool[chosen].lastFrame = this->frame;
+            used[chosen] = true;
+            resource.physical = chosen;
+        }
+
+        this->transientCount = live.size();
+        this->physicalCount = 0;
+        for (bool u : used)
+            if (u)
+                this->physicalCount++;
+        evict();
+    }
+
+    static Physical createPhysical(const RenderTargetDesc& desc)
+    {
+        GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+        switch (desc.format) {
+        case GL_DEPTH24_STENCIL8: format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; break;
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+        case GL_R8:
+        case GL_R16F:
+        case GL_R32F: format = GL_RED; type = GL_FLOAT; break;
+        case GL_RG16F:
+        case GL_RG32F: format = GL_RG; type = GL_FLOAT; break;
+        case GL_RGBA16F:
+        case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT; break;
+        default: break;
+        }
+
+        Physical p;
+        p.desc = desc;
+        p.busyUntil = -1;
+        p.lastFrame = 0;
+        glGenTextures(1, &p.texture);
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D, p.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLState().BindTexture(GL_TEXTURE_2D, 0);
+        return p;
+    }
+
+    // Deletes pooled textures (and FBOs using them) no recent frame needed
+    void evict()
+    {
+        for (size_t p = 0; p < this->pool.size(); ) {
+            if (this->frame - this->pool[p].lastFrame < (size_t)EVICT_FRAMES) {
+                p++;
+                continue;
+            }
+            GLuint texture = this->pool[p].texture;
+            for (auto it = this->framebuffers.begin(); it != this->framebuffers.end(); ) {
+                if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+                    glDeleteFramebuffers(1, &it->second);
+                    it = this->framebuffers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            GLState().DeleteTextures(1, &texture);
+            this->pool.erase(this->pool.begin() + p);
+            // Resources of this frame never point past a still-used entry,
+            // but the indices after p shift down
+            for (Resource& r : this->resources)
+                if (r.physical > (int)p)
+                    r.physical--;
+        }
+    }
+
+    static bool isDepthFormat(GLenum format)
+    {
+        return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+    }
+
+    // Binds the default framebuffer, or an FBO with the pass's targets
+    void bindTargets(const Pass& pass)
+    {
+        std::vector<GLuint> attachments;
+        bool backbuffer = false;
+        for (FrameGraphResource r : pass.writes) {
+            if (this->resources[r].imported)
+                backbuffer = true;
+            else
+                attachments.push_back(Texture(r));
+        }
+        if (backbuffer || attachments.empty()) {
+            if (!attachments.empty())
+                std::cout << "ERROR::FRAME_GRAPH:: Pass " << pass.name << " writes the backbuffer and textures, only the backbuffer is bound" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, this->width, this->height);
+            return;
+        }
+
+        auto found = this->framebuffers.find(attachments);
+        if (found != this->framebuffers.end()) {
+            glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+        } else {
+            GLuint fbo;
+            glGenFramebuffers(1, &fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            std::vector<GLenum> drawBuffers;
+            for (FrameGraphResource r : pass.writes) {
+                GLenum format = this->resources[r].desc.format;
+                GLenum attachment;
+                if (format == GL_DEPTH24_STENCIL8)
+                    attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+                else if (isDepthFormat(format))
+                    attachment = GL_DEPTH_ATTACHMENT;
+                else {
+                    attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+                    drawBuffers.push_back(attachment);
+                }
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, Texture(r), 0);
+            }
+            if (drawBuffers.empty())
+                glDrawBuffer(GL_NONE);
+            else
+                glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAME_GRAPH:: Framebuffer of pass " << pass.name << " is not complete" << std::endl;
+            this->framebuffers[attachments] = fbo;
+        }
+        const RenderTargetDesc& desc = this->resources[pass.writes[0]].desc;
+        glViewport(0, 0, desc.width, desc.height);
+    }
+
+    // Collects the queries issued QUERY_FRAMES ago, which are done by now on
+    // any sane driver; ones still pending are skipped rather than waited on
+    void readTimings()
+    {
+        QueryFrame& slot = this->queries[this->frame % QUERY_FRAMES];
+        std::vector<FramePassTiming> measured;
+        for (PendingQuery& q : slot) {
+            if (!q.issued)
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(q.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return; // keep the previous timings
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(q.query, GL_QUERY_RESULT, &nanoseconds);
+            measured.push_back(FramePassTiming{ q.name, nanoseconds / 1.0e6 });
+            q.issued = false;
+        }
+        if (!measured.empty())
+            this->timings = measured;
+    }
+};
+
+#endif
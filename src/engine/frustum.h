@@ -0,0 +1,67 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <cmath>
+
+// View frustum as six inward-facing planes (xyz = unit normal, w = distance),
+// extracted from a projection * view matrix with the Gribb-Hartmann method.
+// A point p is inside a plane when dot(xyz, p) + w >= 0.
+struct Frustum {
+    enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    glm::vec4 Planes[PLANE_COUNT];
+
+    static Frustum FromMatrix(const glm::mat4& viewProjection) {
+        // glm is column-major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        const glm::mat4& m = viewProjection;
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum f;
+        f.Planes[LEFT] = row3 + row0;
+        f.Planes[RIGHT] = row3 - row0;
+        f.Planes[BOTTOM] = row3 + row1;
+        f.Planes[TOP] = row3 - row1;
+        f.Planes[NEAR_PLANE] = row3 + row2;
+        f.Planes[FAR_PLANE] = row3 - row2;
+        for (int i = 0; i < PLANE_COUNT; i++)
+            f.Planes[i] /= glm::length(glm::vec3(f.Planes[i]));
+        return f;
+    }
+
+    // Conservative: spheres near a frustum corner may pass without being visible
+    bool IntersectsSphere(const glm::vec3& center, float radius) const {
+        for (int i = 0; i < PLANE_COUNT; i++)
+            if (glm::dot(glm::vec3(Planes[i]), center) + Planes[i].w < -radius)
+                return false;
+        return true;
+    }
+};
+
+// Infinite cone, used for the volume lit by a spotlight
+struct Cone {
+    glm::vec3 Apex;
+    glm::vec3 Direction; // unit length
+    float CosAngle;      // cosine of the half angle
+    float SinAngle;
+
+    Cone() : Apex(0.0f), Direction(0.0f, 0.0f, -1.0f), CosAngle(1.0f), SinAngle(0.0f) {}
+
+    Cone(glm::vec3 apex, glm::vec3 direction, float halfAngleRadians)
+        : Apex(apex), Direction(glm::normalize(direction)),
+          CosAngle(std::cos(halfAngleRadians)), SinAngle(std::sin(halfAngleRadians)) {}
+
+    // Moves the apex back by radius / sin(angle) so the widened cone contains
+    // every sphere that touches the original one, then tests the center as a point
+    bool IntersectsSphere(const glm::vec3& center, float radius) const {
+        if (SinAngle <= 0.0f) return false;
+        glm::vec3 d = center - (Apex - Direction * (radius / SinAngle));
+        float along = glm::dot(d, Direction);
+        return along > 0.0f && along * along >= glm::dot(d, d) * CosAngle * CosAngle;
+    }
+};
+
+#endif
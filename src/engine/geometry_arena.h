@@ -0,0 +1,117 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include "libs/glad.h"
+#include <cstddef>
+#include <vector>
+
+#include "engine/mesh.h"
+#include "engine/model.h"
+#include "engine/gl45.h"
+
+// Where a piece of geometry landed in a GeometryArena. Draw it with
+// glDrawElements*BaseVertex(firstIndex, indexCount, baseVertex), or
+// glDrawArrays*(baseVertex, vertexCount) if it has no indices.
+struct GeometryRange {
+    int baseVertex;
+    unsigned int vertexCount;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+// One VBO/EBO pair shared by many meshes, so a single VAO can draw all of
+// them. Geometry is staged with Add, then sent to the GPU once by Upload.
+// Indices stay relative to each mesh's own vertices; the base vertex of the
+// draw call moves them to the mesh's slot in the VBO.
+class GeometryArena
+{
+public:
+    unsigned int VBO, EBO;
+
+    GeometryArena() : VBO(0), EBO(0) {}
+
+    GeometryRange Add(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        GeometryRange range;
+        range.baseVertex = (int)stagedVertices.size();
+        range.vertexCount = (unsigned int)vertices.size();
+        range.firstIndex = (unsigned int)stagedIndices.size();
+        range.indexCount = (unsigned int)indices.size();
+        stagedVertices.insert(stagedVertices.end(), vertices.begin(), vertices.end());
+        stagedIndices.insert(stagedIndices.end(), indices.begin(), indices.end());
+        return range;
+    }
+
+    // Every LOD of a mesh (Mesh::Lods offsets are relative to firstIndex)
+    GeometryRange AddMesh(const Mesh& mesh)
+    {
+        return Add(mesh.vertices, mesh.lodIndices);
+    }
+
+    // Appends every mesh of model, ranges[i] being model.meshes[i]
+    void AddModel(const Model& model, std::vector<GeometryRange>& ranges)
+    {
+        for (const Mesh& mesh : model.meshes)
+            ranges.push_back(AddMesh(mesh));
+    }
+
+    // Creates the buffers from everything added so far and frees the staging copy
+    void Upload()
+    {
+        if (VBO == 0) {
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, stagedVertices.size() * sizeof(Vertex), stagedVertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // The EBO binding is VAO state, so don't disturb whatever VAO is bound
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, stagedIndices.size() * sizeof(unsigned int), stagedIndices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        std::vector<Vertex>().swap(stagedVertices);
+        std::vector<unsigned int>().swap(stagedIndices);
+    }
+
+    // Binds the VBO/EBO and sets up attributes 0..4 (same layout as Mesh) on
+    // the currently bound VAO
+    void BindVertexAttributes() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
+
+    // Same layout as BindVertexAttributes, set with direct state access on
+    // vao: the VBO goes to vertex buffer `binding` and the EBO is attached.
+    // Needs a 4.5 context (GL45().loaded).
+    void SetVertexAttributes(unsigned int vao, unsigned int binding) const
+    {
+        GL45Functions& gl = GL45();
+        gl.VertexArrayVertexBuffer(vao, binding, VBO, 0, sizeof(Vertex));
+        gl.VertexArrayElementBuffer(vao, EBO);
+        const GLint sizes[5] = { 3, 3, 2, 3, 3 };
+        const GLuint offsets[5] = { 0, offsetof(Vertex, Normal), offsetof(Vertex, TexCoords),
+                                    offsetof(Vertex, Tangent), offsetof(Vertex, Bitangent) };
+        for (GLuint location = 0; location < 5; location++) {
+            gl.EnableVertexArrayAttrib(vao, location);
+            gl.VertexArrayAttribFormat(vao, location, sizes[location], GL_FLOAT, GL_FALSE, offsets[location]);
+            gl.VertexArrayAttribBinding(vao, location, binding);
+        }
+    }
+
+private:
+    std::vector<Vertex> stagedVertices;
+    std::vector<unsigned int> stagedIndices;
+};
+
+#endif
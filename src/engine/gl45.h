@@ -0,0 +1,137 @@
+#ifndef GL45_H
+#define GL45_H
+
+#include "libs/glad.h"
+#include <iostream>
+
+// The bundled glad only covers GL 3.3 core. The GPU-driven asteroid path
+// needs a few 4.3-4.5 entry points (direct state access, buffer storage,
+// compute and multi-draw indirect), so they are loaded here by hand once a
+// 4.5 context is current. Nothing in this file is touched on a 3.3 context.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT
+#define GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT 0x00004000
+#endif
+
+// One entry of a GL_DRAW_INDIRECT_BUFFER for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;         // indices
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;  // offsets every divisor-1 attribute, like firstInstance
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+struct GL45Functions {
+    typedef void (APIENTRYP CreateBuffersProc)(GLsizei n, GLuint* buffers);
+    typedef void (APIENTRYP NamedBufferStorageProc)(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags);
+    typedef void (APIENTRYP NamedBufferSubDataProc)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+    typedef void* (APIENTRYP MapNamedBufferRangeProc)(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    typedef void (APIENTRYP CopyNamedBufferSubDataProc)(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+    typedef void (APIENTRYP CreateVertexArraysProc)(GLsizei n, GLuint* arrays);
+    typedef void (APIENTRYP VertexArrayVertexBufferProc)(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride);
+    typedef void (APIENTRYP VertexArrayElementBufferProc)(GLuint vaobj, GLuint buffer);
+    typedef void (APIENTRYP EnableVertexArrayAttribProc)(GLuint vaobj, GLuint index);
+    typedef void (APIENTRYP VertexArrayAttribFormatProc)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset);
+    typedef void (APIENTRYP VertexArrayAttribIFormatProc)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLuint relativeoffset);
+    typedef void (APIENTRYP VertexArrayAttribBindingProc)(GLuint vaobj, GLuint attribindex, GLuint bindingindex);
+    typedef void (APIENTRYP VertexArrayBindingDivisorProc)(GLuint vaobj, GLuint bindingindex, GLuint divisor);
+    typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+    typedef void (APIENTRYP DispatchComputeProc)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+    typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+
+    CreateBuffersProc CreateBuffers;
+    NamedBufferStorageProc NamedBufferStorage;
+    NamedBufferSubDataProc NamedBufferSubData;
+    MapNamedBufferRangeProc MapNamedBufferRange;
+    CopyNamedBufferSubDataProc CopyNamedBufferSubData;
+    CreateVertexArraysProc CreateVertexArrays;
+    VertexArrayVertexBufferProc VertexArrayVertexBuffer;
+    VertexArrayElementBufferProc VertexArrayElementBuffer;
+    EnableVertexArrayAttribProc EnableVertexArrayAttrib;
+    VertexArrayAttribFormatProc VertexArrayAttribFormat;
+    VertexArrayAttribIFormatProc VertexArrayAttribIFormat;
+    VertexArrayAttribBindingProc VertexArrayAttribBinding;
+    VertexArrayBindingDivisorProc VertexArrayBindingDivisor;
+    MultiDrawElementsIndirectProc MultiDrawElementsIndirect;
+    DispatchComputeProc DispatchCompute;
+    MemoryBarrierProc MemoryBarrier;
+    bool loaded;
+
+    GL45Functions() : loaded(false) {}
+
+    // Loads every entry point if the current context is 4.5 or newer.
+    // Returns false (and leaves the 3.3 paths in charge) otherwise.
+    bool Load(GLADloadproc load)
+    {
+        loaded = false;
+        if (GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 5))
+            return false;
+        bool ok = true;
+        ok &= get(load, "glCreateBuffers", CreateBuffers);
+        ok &= get(load, "glNamedBufferStorage", NamedBufferStorage);
+        ok &= get(load, "glNamedBufferSubData", NamedBufferSubData);
+        ok &= get(load, "glMapNamedBufferRange", MapNamedBufferRange);
+        ok &= get(load, "glCopyNamedBufferSubData", CopyNamedBufferSubData);
+        ok &= get(load, "glCreateVertexArrays", CreateVertexArrays);
+        ok &= get(load, "glVertexArrayVertexBuffer", VertexArrayVertexBuffer);
+        ok &= get(load, "glVertexArrayElementBuffer", VertexArrayElementBuffer);
+        ok &= get(load, "glEnableVertexArrayAttrib", EnableVertexArrayAttrib);
+        ok &= get(load, "glVertexArrayAttribFormat", VertexArrayAttribFormat);
+        ok &= get(load, "glVertexArrayAttribIFormat", VertexArrayAttribIFormat);
+        ok &= get(load, "glVertexArrayAttribBinding", VertexArrayAttribBinding);
+        ok &= get(load, "glVertexArrayBindingDivisor", VertexArrayBindingDivisor);
+        ok &= get(load, "glMultiDrawElementsIndirect", MultiDrawElementsIndirect);
+        ok &= get(load, "glDispatchCompute", DispatchCompute);
+        ok &= get(load, "glMemoryBarrier", MemoryBarrier);
+        if (!ok)
+            std::cout << "ERROR::GL45:: Context reports 4.5 but some entry points are missing" << std::endl;
+        loaded = ok;
+        return ok;
+    }
+
+private:
+    template <typename T>
+    static bool get(GLADloadproc load, const char* name, T& function)
+    {
+        function = (T)load(name);
+        return function != nullptr;
+    }
+};
+
+// Process-wide table, filled by GL45().Load after the context is created
+inline GL45Functions& GL45()
+{
+    static GL45Functions functions;
+    return functions;
+}
+
+#endif
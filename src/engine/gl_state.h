@@ -0,0 +1,235 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include "libs/glad.h"
+#include <cstddef>
+#include <cstdint>
+
+// Shadow copy of the GL state the renderer changes most often: capabilities,
+// blend/depth/stencil functions and masks, face culling, the bound program,
+// VAO and textures. Each setter compares with the last value it set and skips
+// the GL call when nothing would change, so draw code can set what it needs
+// (and restore what it changed) without paying for redundant driver calls.
+//
+// The cache only stays right if every change goes through GLState(). Code
+// that touches this state directly must call Invalidate() afterwards.
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    GLStateCache() : issued(0), skipped(0), issuedLastFrame(0), skippedLastFrame(0)
+    {
+        Invalidate();
+    }
+
+    // Forgets every cached value, so the next call of each setter reaches GL
+    void Invalidate()
+    {
+        for (int i = 0; i < CAPABILITY_COUNT; i++)
+            capabilities[i].known = false;
+        blendFunc.known = false;
+        depthFunc.known = false;
+        depthMask.known = false;
+        cullFace.known = false;
+        frontFace.known = false;
+        stencilFunc.known = false;
+        stencilOp.known = false;
+        stencilMask.known = false;
+        program.known = false;
+        vertexArray.known = false;
+        activeTexture.known = false;
+        for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            for (int t = 0; t < TEXTURE_TARGET_COUNT; t++)
+                textures[unit][t].known = false;
+    }
+
+    // Starts counting a new frame; the previous frame's counts stay readable
+    void BeginFrame()
+    {
+        issuedLastFrame = issued;
+        skippedLastFrame = skipped;
+        issued = 0;
+        skipped = 0;
+    }
+
+    size_t IssuedLastFrame() const { return issuedLastFrame; }
+    size_t SkippedLastFrame() const { return skippedLastFrame; }
+
+    void Enable(GLenum capability) { setCapability(capability, true); }
+    void Disable(GLenum capability) { setCapability(capability, false); }
+
+    void BlendFunc(GLenum source, GLenum destination)
+    {
+        if (update(blendFunc, source, destination))
+            glBlendFunc(source, destination);
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (update(depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void DepthMask(GLboolean flag)
+    {
+        if (update(depthMask, flag))
+            glDepthMask(flag);
+    }
+
+    void CullFace(GLenum mode)
+    {
+        if (update(cullFace, mode))
+            glCullFace(mode);
+    }
+
+    void FrontFace(GLenum mode)
+    {
+        if (update(frontFace, mode))
+            glFrontFace(mode);
+    }
+
+    void StencilFunc(GLenum func, GLint ref, GLuint mask)
+    {
+        if (update(stencilFunc, ((uint64_t)func << 32) | (uint32_t)ref, mask))
+            glStencilFunc(func, ref, mask);
+    }
+
+    void StencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass)
+    {
+        if (update(stencilOp, ((uint64_t)stencilFail << 32) | depthFail, depthPass))
+            glStencilOp(stencilFail, depthFail, depthPass);
+    }
+
+    void StencilMask(GLuint mask)
+    {
+        if (update(stencilMask, mask))
+            glStencilMask(mask);
+    }
+
+    void UseProgram(GLuint id)
+    {
+        if (update(program, id))
+            glUseProgram(id);
+    }
+
+    void BindVertexArray(GLuint vao)
+    {
+        if (update(vertexArray, vao))
+            glBindVertexArray(vao);
+    }
+
+    // unit is GL_TEXTURE0 + i, as for glActiveTexture
+    void ActiveTexture(GLenum unit)
+    {
+        if (update(activeTexture, unit))
+            glActiveTexture(unit);
+    }
+
+    // Binds to the active texture unit
+    void BindTexture(GLenum target, GLuint texture)
+    {
+        int t = textureTargetIndex(target);
+        int unit = activeTexture.known ? (int)(activeTexture.a - GL_TEXTURE0) : -1;
+        if (t < 0 || unit < 0 || unit >= MAX_TEXTURE_UNITS) {
+            issued++;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (update(textures[unit][t], texture))
+            glBindTexture(target, texture);
+    }
+
+    // glDeleteTextures through the cache. GL rebinds 0 wherever a deleted
+    // texture was bound, and the cache must follow: if it kept the old name
+    // and GL handed that name out again, binding the new texture would be
+    // skipped.
+    void DeleteTextures(GLsizei count, const GLuint* names)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+                for (int t = 0; t < TEXTURE_TARGET_COUNT; t++)
+                    if (textures[unit][t].known && textures[unit][t].a == names[i])
+                        textures[unit][t].a = 0;
+        glDeleteTextures(count, names);
+    }
+
+private:
+    // A cached value of up to two words; `known` is false until first set
+    struct Cached {
+        uint64_t a, b;
+        bool known;
+    };
+
+    enum { CAPABILITY_COUNT = 7, TEXTURE_TARGET_COUNT = 4 };
+
+    Cached capabilities[CAPABILITY_COUNT];
+    Cached blendFunc, depthFunc, depthMask, cullFace, frontFace;
+    Cached stencilFunc, stencilOp, stencilMask;
+    Cached program, vertexArray, activeTexture;
+    Cached textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+    size_t issued, skipped;
+    size_t issuedLastFrame, skippedLastFrame;
+
+    // True (and the cache updated) when the call has to reach GL
+    bool update(Cached& cached, uint64_t a, uint64_t b = 0)
+    {
+        if (cached.known && cached.a == a && cached.b == b) {
+            skipped++;
+            return false;
+        }
+        cached.a = a;
+        cached.b = b;
+        cached.known = true;
+        issued++;
+        return true;
+    }
+
+    static int capabilityIndex(GLenum capability)
+    {
+        switch (capability) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_BLEND: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_STENCIL_TEST: return 3;
+        case GL_MULTISAMPLE: return 4;
+        case GL_RASTERIZER_DISCARD: return 5;
+        case GL_TEXTURE_CUBE_MAP_SEAMLESS: return 6;
+        default: return -1;
+        }
+    }
+
+    static int textureTargetIndex(GLenum target)
+    {
+        switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        default: return -1;
+        }
+    }
+
+    // Capabilities the cache doesn't know always reach GL
+    void setCapability(GLenum capability, bool enabled)
+    {
+        int i = capabilityIndex(capability);
+        if (i >= 0 && !update(capabilities[i], enabled ? 1 : 0))
+            return;
+        if (i < 0)
+            issued++;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+};
+
+// Process-wide cache for the one GL context
+inline GLStateCache& GLState()
+{
+    static GLStateCache state;
+    return state;
+}
+
+#endif
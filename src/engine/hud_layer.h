@@ -0,0 +1,131 @@
+#ifndef HUD_LAYER_H
+#define HUD_LAYER_H
+
+#include "libs/glad.h"
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "engine/shader.h"
+#include "engine/gl_state.h"
+
+// Retained HUD: the overlay is rendered into a screen-sized texture only when
+// its content key changes (or the window is resized), and every frame just
+// blends that texture over the scene with one full-screen draw. The per-frame
+// cost stays one draw however many widgets the overlay has.
+class HudLayer
+{
+public:
+    Shader shader;
+    unsigned int texture;
+    unsigned int FBO;
+    size_t redrawCount; // times the cache was rebuilt
+
+    HudLayer() : shader("shaders/hud_composite_vertex.glsl", "shaders/hud_composite_fragment.glsl"),
+                 texture(0), FBO(0), redrawCount(0), width(0), height(0), valid(false)
+    {
+        glGenVertexArrays(1, &this->emptyVAO);
+        shader.use();
+        shader.setInt("hudTexture", 0);
+    }
+
+    HudLayer(const HudLayer&) = delete;
+    HudLayer& operator=(const HudLayer&) = delete;
+
+    // Deletes the cache texture, its FBO and the empty VAO. Call it while the
+    // GL context is still current (before glfwTerminate).
+    void Release()
+    {
+        if (this->texture != 0)
+            GLState().DeleteTextures(1, &this->texture);
+        if (this->FBO != 0)
+            glDeleteFramebuffers(1, &this->FBO);
+        if (this->emptyVAO != 0)
+            glDeleteVertexArrays(1, &this->emptyVAO);
+        this->texture = 0;
+        this->FBO = 0;
+        this->emptyVAO = 0;
+        this->width = 0;
+        this->height = 0;
+        this->valid = false;
+    }
+
+    // key identifies everything the overlay shows (e.g. score, lives, text
+    // lines). render draws the overlay to the currently bound target with a
+    // scrWidth x scrHeight viewport; it only runs when key changed. The
+    // composite goes to whatever framebuffer was bound on entry (the frame
+    // graph's target for the pass), with its viewport.
+    void Draw(const std::string& key, int scrWidth, int scrHeight, const std::function<void()>& render)
+    {
+        if (scrWidth <= 0 || scrHeight <= 0)
+            return;
+        if (scrWidth != this->width || scrHeight != this->height)
+            resize(scrWidth, scrHeight);
+
+        if (!this->valid || key != this->cachedKey) {
+            GLint previousFramebuffer = 0;
+            GLint previousViewport[4];
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+            glGetIntegerv(GL_VIEWPORT, previousViewport);
+            glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+            glViewport(0, 0, this->width, this->height);
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            render();
+            glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+            glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+            this->cachedKey = key;
+            this->valid = true;
+            this->redrawCount++;
+        }
+
+        // Composite over whatever the bound target holds
+        GLState().Disable(GL_DEPTH_TEST);
+        GLState().Enable(GL_BLEND);
+        GLState().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        shader.use();
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D, this->texture);
+        GLState().BindVertexArray(this->emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        GLState().BindVertexArray(0);
+        GLState().Disable(GL_BLEND);
+        GLState().Enable(GL_DEPTH_TEST);
+    }
+
+private:
+    unsigned int emptyVAO; // core profile needs a VAO bound even without attributes
+    int width, height;
+    std::string cachedKey;
+    bool valid;
+
+    void resize(int scrWidth, int scrHeight)
+    {
+        this->width = scrWidth;
+        this->height = scrHeight;
+        this->valid = false;
+        if (this->texture == 0) {
+            glGenTextures(1, &this->texture);
+            glGenFramebuffers(1, &this->FBO);
+        }
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D, this->texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        // Composited 1:1 with the screen
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLState().BindTexture(GL_TEXTURE_2D, 0);
+
+        GLint previousFramebuffer = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::HUD_LAYER:: Framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+};
+
+#endif
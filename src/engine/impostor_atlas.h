@@ -0,0 +1,230 @@
+#ifndef IMPOSTOR_ATLAS_H
+#define IMPOSTOR_ATLAS_H
+
+#include "libs/glad.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "engine/model.h"
+#include "engine/shader.h"
+#include "engine/gl_state.h"
+
+// Limits of the uniform arrays in asteroid_impostor_vertex.glsl
+const int IMPOSTOR_MAX_VIEWS = 32;
+const int IMPOSTOR_MAX_MESHES = 16;
+// Last mip level of the atlases. Each tile keeps a transparent gutter of
+// 2^level pixels, so even at that level bilinear taps stay inside the tile
+// instead of blending in its neighbours.
+const int IMPOSTOR_MAX_MIP_LEVEL = 2;
+
+// Pre-rendered views of every (mesh, texture) pair of a model, used to draw
+// far-away copies as a single textured quad.
+// Each mesh is rendered from viewCount directions spread over the sphere into
+// one tile of two atlases: albedo (alpha = coverage) and the normal in the
+// bake camera's frame, so impostors can still be lit. A tile is an orthographic
+// view of the mesh bounding sphere, so the quad that shows it is 2 * radius wide.
+class ImpostorAtlas
+{
+public:
+    unsigned int albedoTexture;
+    unsigned int normalTexture;
+    int tileSize;   // pixels
+    int gutter;     // transparent pixels on each side of a tile
+    int maxLevel;   // last mip level (see IMPOSTOR_MAX_MIP_LEVEL)
+    int columns, rows;
+    int viewCount;
+    int layerCount; // textures per mesh
+    int meshCount;
+    float padding;  // the tile covers radius * padding, so silhouettes aren't clipped
+    std::vector<glm::vec3> viewDirections; // unit, from the mesh center toward the bake camera
+    std::vector<glm::vec3> viewRights;
+    std::vector<glm::vec3> viewUps;
+
+    ImpostorAtlas()
+        : albedoTexture(0), normalTexture(0), tileSize(0), gutter(0), maxLevel(0), columns(0), rows(0),
+          viewCount(0), layerCount(0), meshCount(0), padding(1.05f) {}
+
+    // Largest screen-space radius (pixels) of a bounding sphere that an
+    // impostor shows without magnifying its tile
+    float MaxScreenRadius() const
+    {
+        return (tileSize - 2 * gutter) / (2.0f * padding);
+    }
+
+    // Orthonormal camera frame looking along -direction (same as glm::lookAt)
+    static void ViewBasis(const glm::vec3& direction, glm::vec3& right, glm::vec3& up)
+    {
+        glm::vec3 reference = std::fabs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        right = glm::normalize(glm::cross(reference, direction));
+        up = glm::cross(direction, right);
+    }
+
+    // Renders every tile: each mesh with each layer of textureArray (a
+    // GL_TEXTURE_2D_ARRAY). bakeShader is impostor_bake_vertex/fragment.glsl.
+    void Bake(Model& model, unsigned int textureArray, int layers, Shader& bakeShader, int views = 16, int tile = 64)
+    {
+        meshCount = std::min((int)model.meshes.size(), IMPOSTOR_MAX_MESHES);
+        layerCount = std::max(layers, 1);
+        viewCount = std::min(std::max(views, 1), IMPOSTOR_MAX_VIEWS);
+        if (meshCount == 0) return;
+
+        // Fibonacci sphere: evenly spread directions
+        viewDirections.resize(viewCount);
+        viewRights.resize(viewCount);
+        viewUps.resize(viewCount);
+        const float goldenAngle = 2.39996323f;
+        for (int i = 0; i < viewCount; i++) {
+            float y = viewCount > 1 ? 1.0f - 2.0f * (i + 0.5f) / viewCount : 0.0f;
+            float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+            float phi = goldenAngle * i;
+            viewDirections[i] = glm::vec3(std::cos(phi) * r, y, std::sin(phi) * r);
+            ViewBasis(viewDirections[i], viewRights[i], viewUps[i]);
+        }
+
+        int tiles = meshCount * layerCount * viewCount;
+        columns = (int)std::ceil(std::sqrt((float)tiles));
+        rows = (tiles + columns - 1) / columns;
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        tileSize = tile;
+        while (tileSize > 8 && (columns * tileSize > maxSize || rows * tileSize > maxSize))
+            tileSize /= 2;
+        int width = columns * tileSize;
+        int height = rows * tileSize;
+        // Keep at least 8 pixels of tile at the last level
+        maxLevel = IMPOSTOR_MAX_MIP_LEVEL;
+        while (maxLevel > 0 && (tileSize >> maxLevel) < 8)
+            maxLevel--;
+        gutter = 1 << maxLevel;
+
+        albedoTexture = createTexture(width, height, maxLevel);
+        normalTexture = createTexture(width, height, maxLevel);
+
+        unsigned int fbo, depth;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::IMPOSTOR_ATLAS:: Framebuffer is not complete" << std::endl;
+
+        GLint previousViewport[4];
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GLState().Enable(GL_DEPTH_TEST);
+        GLState().Disable(GL_CULL_FACE);
+
+        bakeShader.use();
+        bakeShader.setInt("texture_array", 0);
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        for (int mesh = 0; mesh < meshCount; mesh++) {
+            Mesh& m = model.meshes[mesh];
+            float extent = m.Radius * padding;
+            glm::mat4 projection = glm::ortho(-extent, extent, -extent, extent, 0.0f, 4.0f * extent);
+            bakeShader.setMat4("projection", projection);
+            for (int layer = 0; layer < layerCount; layer++) {
+                bakeShader.setInt("layer", layer);
+                for (int view = 0; view < viewCount; view++) {
+                    int t = TileIndex(mesh, layer, view);
+                    glViewport((t % columns) * tileSize + gutter, (t / columns) * tileSize + gutter,
+                               tileSize - 2 * gutter, tileSize - 2 * gutter);
+                    glm::vec3 eye = m.Center + viewDirections[view] * (2.0f * extent);
+                    bakeShader.setMat4("view", glm::lookAt(eye, m.Center, viewUps[view]));
+                    GLState().BindVertexArray(m.VAO);
+                    glDrawElements(GL_TRIANGLES, m.Lods[0].indexCount, GL_UNSIGNED_INT, 0);
+                }
+            }
+        }
+        GLState().BindVertexArray(0);
+        GLState().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteFramebuffers(1, &fbo);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        if (cullFace) GLState().Enable(GL_CULL_FACE);
+        if (!depthTest) GLState().Disable(GL_DEPTH_TEST);
+
+        GLState().BindTexture(GL_TEXTURE_2D, albedoTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        GLState().BindTexture(GL_TEXTURE_2D, normalTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        GLState().BindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    int TileIndex(int mesh, int layer, int view) const
+    {
+        return (mesh * layerCount + layer) * viewCount + view;
+    }
+
+    // Uploads the atlas layout and view frames to an asteroid_impostor_vertex.glsl
+    // program. They never change, so this runs once after Bake.
+    void SetUniforms(Shader& shader, const std::vector<glm::vec3>& meshCenters, const std::vector<float>& meshRadii)
+    {
+        shader.use();
+        shader.setInt("viewCount", viewCount);
+        shader.setInt("layerCount", layerCount);
+        shader.setInt("atlasColumns", columns);
+        shader.setVec2("tileSize", 1.0f / columns, 1.0f / rows);
+        shader.setFloat("tileInset", (float)gutter / tileSize);
+        shader.setFloat("boundsPadding", padding);
+        for (int i = 0; i < viewCount; i++) {
+            std::string index = "[" + std::to_string(i) + "]";
+            shader.setVec3("impostorDirections" + index, viewDirections[i]);
+            shader.setVec3("impostorRights" + index, viewRights[i]);
+            shader.setVec3("impostorUps" + index, viewUps[i]);
+        }
+        for (int i = 0; i < meshCount && i < (int)meshCenters.size(); i++) {
+            std::string index = "[" + std::to_string(i) + "]";
+            shader.setVec3("meshCenters" + index, meshCenters[i]);
+            shader.setFloat("meshRadii" + index, meshRadii[i]);
+        }
+        shader.setInt("impostorAlbedo", 0);
+        shader.setInt("impostorNormal", 1);
+    }
+
+    void BindTextures() const
+    {
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D, albedoTexture);
+        GLState().ActiveTexture(GL_TEXTURE1);
+        GLState().BindTexture(GL_TEXTURE_2D, normalTexture);
+        GLState().ActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    static unsigned int createTexture(int width, int height, int maxLevel)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        GLState().BindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLState().BindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
+
+#endif
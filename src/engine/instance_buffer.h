@@ -0,0 +1,53 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include "libs/glad.h"
+#include <cstddef>
+
+// Long-lived vertex buffer for per-instance data that is rewritten every frame.
+// The buffer name never changes, so a VAO can capture it once in its attribute
+// layout. Each upload orphans the previous storage (glBufferData with NULL), which
+// lets the driver hand out fresh memory while the GPU may still be reading last
+// frame's instances, instead of stalling or recreating the buffer.
+class InstanceBuffer
+{
+public:
+    unsigned int VBO;
+    size_t capacity; // bytes
+
+    InstanceBuffer() : VBO(0), capacity(0) {}
+
+    void Init(size_t initialBytes = 0)
+    {
+        if (VBO == 0)
+            glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        capacity = initialBytes;
+        glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Bind for attribute setup (call with the target VAO bound)
+    void Bind() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    }
+
+    void Upload(const void* data, size_t bytes)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (bytes > capacity) {
+            // Grow geometrically so a slowly rising count doesn't reallocate every frame
+            size_t newCapacity = capacity > 0 ? capacity : 4096;
+            while (newCapacity < bytes) newCapacity *= 2;
+            capacity = newCapacity;
+        }
+        // Orphan the old storage, then fill the new one
+        glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        if (bytes > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it pushes and pops its own jobs at the back (LIFO,
+// cache friendly) and steals from the front of the other deques when it runs
+// dry. Threads that wait on a job counter (including the main thread) run jobs
+// while they wait, so nested ParallelFor calls and a pool with zero workers
+// both work.
+class JobSystem
+{
+public:
+    typedef std::function<void()> JobFn;
+
+    // Leaves one core for the main thread
+    static unsigned int DefaultWorkerCount()
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+    explicit JobSystem(unsigned int workerCount = DefaultWorkerCount())
+        : running(true), queued(0), nextQueue(0)
+    {
+        // Queue 0 receives jobs submitted from outside the pool
+        for (unsigned int i = 0; i < workerCount + 1; i++)
+            queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+        for (unsigned int i = 0; i < workerCount; i++)
+            threads.push_back(std::thread(&JobSystem::workerLoop, this, (int)i + 1));
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running = false;
+        }
+        wake.notify_all();
+        for (auto& t : threads)
+            t.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int WorkerCount() const { return (unsigned int)threads.size(); }
+
+    // Queues fn; counter (set up by the caller) is decremented once fn has run
+    void Submit(JobFn fn, std::atomic<int>* counter)
+    {
+        int self = currentQueue();
+        WorkerQueue& queue = *queues[self >= 0 ? self : nextQueue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(Job{ std::move(fn), counter });
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // Queues fn for the worker threads only. Threads that help while they wait
+    // (the main thread included) never pick these up, so slow work submitted
+    // here can't stall a frame. Runs fn right away if the pool has no workers.
+    void SubmitBackground(JobFn fn, std::atomic<int>* counter)
+    {
+        if (threads.empty()) {
+            fn();
+            if (counter)
+                counter->fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(background.mutex);
+            background.jobs.push_back(Job{ std::move(fn), counter });
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // Runs queued jobs until counter drops to zero
+    void Wait(const std::atomic<int>& counter)
+    {
+        int self = currentQueue();
+        while (counter.load(std::memory_order_acquire) > 0) {
+            if (!tryRunOne(self))
+                std::this_thread::yield();
+        }
+    }
+
+    // Calls fn(begin, end) over [0, count) in chunks of `grain` and blocks until done
+    template <typename Fn>
+    void ParallelFor(size_t count, size_t grain, const Fn& fn)
+    {
+        if (count == 0) return;
+        if (grain == 0) grain = 1;
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks == 1 || threads.empty()) {
+            fn((size_t)0, count);
+            return;
+        }
+
+        std::atomic<int> counter((int)chunks - 1);
+        for (size_t c = 1; c < chunks; c++) {
+            size_t begin = c * grain;
+            size_t end = std::min(begin + grain, count);
+            Submit([&fn, begin, end]() { fn(begin, end); }, &counter);
+        }
+        // The calling thread takes the first chunk itself
+        fn((size_t)0, std::min(grain, count));
+        Wait(counter);
+    }
+
+private:
+    struct Job {
+        JobFn fn;
+        std::atomic<int>* counter;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue> > queues;
+    WorkerQueue background; // SubmitBackground jobs, taken only by idle workers
+    std::vector<std::thread> threads;
+    bool running;
+    int queued;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<unsigned int> nextQueue;
+
+    // Queue owned by the calling thread, -1 for threads outside the pool
+    static int& threadQueueIndex()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    int currentQueue() const
+    {
+        return threadQueueIndex();
+    }
+
+    bool popOwn(int self, Job& job)
+    {
+        WorkerQueue& queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(size_t victim, Job& job)
+    {
+        WorkerQueue& queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        return true;
+    }
+
+    bool tryRunOne(int self, bool takeBackground = false)
+    {
+        Job job;
+        bool found = self >= 0 && popOwn(self, job);
+        if (!found) {
+            size_t n = queues.size();
+            size_t start = self >= 0 ? (size_t)self + 1 : 0;
+            for (size_t k = 0; k < n && !found; k++) {
+                size_t victim = (start + k) % n;
+                if ((int)victim == self) continue;
+                found = steal(victim, job);
+            }
+        }
+        if (!found && takeBackground) {
+            std::lock_guard<std::mutex> lock(background.mutex);
+            if (!background.jobs.empty()) {
+                job = std::move(background.jobs.front());
+                background.jobs.pop_front();
+                found = true;
+            }
+        }
+        if (!found) return false;
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued--;
+        }
+        job.fn();
+        if (job.counter)
+            job.counter->fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void workerLoop(int index)
+    {
+        threadQueueIndex() = index;
+        while (true) {
+            if (tryRunOne(index, true)) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]() { return !running || queued > 0; });
+            if (!running) return;
+        }
+    }
+};
+
+// Dependency-aware group of jobs. Add tasks, declare ordering with Precede,
+// then Run submits every task as soon as all of its predecessors have finished.
+class TaskGraph
+{
+public:
+    typedef int TaskId;
+
+    TaskId Add(std::function<void()> fn)
+    {
+        nodes.push_back(std::unique_ptr<Node>(new Node()));
+        nodes.back()->fn = std::move(fn);
+        return (TaskId)nodes.size() - 1;
+    }
+
+    // `after` only starts once `before` has completed
+    void Precede(TaskId before, TaskId after)
+    {
+        nodes[before]->successors.push_back(after);
+        nodes[after]->dependencies++;
+    }
+
+    // Blocks until every task has run; the calling thread helps
+    void Run(JobSystem& jobs)
+    {
+        std::atomic<int> remaining((int)nodes.size());
+        for (auto& node : nodes)
+            node->pending.store(node->dependencies);
+        for (size_t i = 0; i < nodes.size(); i++)
+            if (nodes[i]->dependencies == 0)
+                submit(jobs, (TaskId)i, remaining);
+        jobs.Wait(remaining);
+    }
+
+private:
+    struct Node {
+        std::function<void()> fn;
+        std::vector<TaskId> successors;
+        int dependencies = 0;
+        std::atomic<int> pending;
+    };
+
+    std::vector<std::unique_ptr<Node> > nodes;
+
+    void submit(JobSystem& jobs, TaskId id, std::atomic<int>& remaining)
+    {
+        jobs.Submit([this, &jobs, id, &remaining]() {
+            Node& node = *nodes[id];
+            node.fn();
+            // Successors are queued before this job counts as done, so
+            // `remaining` can't reach zero while work is still pending
+            for (TaskId next : node.successors)
+                if (nodes[next]->pending.fetch_sub(1) == 1)
+                    submit(jobs, next, remaining);
+        }, &remaining);
+    }
+};
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include "libs/glad.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "engine/shader.h"
+#include "engine/gl_state.h"
+#include "engine/uniform_blocks.h"
+
+// Clustered forward shading for point lights. The view frustum is split into
+// a grid of screen tiles by exponential depth slices; each frame every light
+// is assigned on the CPU to the clusters its influence sphere touches, and
+// the lists are uploaded to three texture buffers. A fragment finds its
+// cluster from gl_FragCoord and its view depth and only evaluates those lights,
+// so the light count is no longer bounded by the size of a uniform block.
+
+const int LIGHT_CLUSTERS_X = 16;
+const int LIGHT_CLUSTERS_Y = 9;
+const int LIGHT_CLUSTERS_Z = 24;
+const int LIGHT_CLUSTER_COUNT = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z;
+
+// Texture units of the cluster buffers, after the asteroid texture array (8)
+const int LIGHT_DATA_TEXTURE_UNIT = 9;
+const int CLUSTER_GRID_TEXTURE_UNIT = 10;
+const int CLUSTER_LIGHTS_TEXTURE_UNIT = 11;
+
+// A light never reaches farther than where its attenuated peak drops below this
+const float LIGHT_INFLUENCE_CUTOFF = 1.0f / 256.0f;
+
+struct ScenePointLight {
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+    float radius; // influence radius; 0 = until the attenuation cutoff
+};
+
+// Radius of the light's influence sphere: its own radius, or less if
+// 1 / (c + l*d + q*d^2) scales its brightest channel down to
+// LIGHT_INFLUENCE_CUTOFF before that. The shaders fade the light to zero at
+// this distance, so clipping the sphere there causes no visible edge.
+inline float PointLightRadius(const ScenePointLight& light)
+{
+    glm::vec3 peak = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+    float intensity = std::max(peak.x, std::max(peak.y, peak.z));
+    float c = light.constant - intensity / LIGHT_INFLUENCE_CUTOFF;
+    if (c >= 0.0f)
+        return 0.0f; // never brighter than the cutoff
+    float cutoff;
+    if (light.quadratic > 0.0f)
+        cutoff = (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+    else if (light.linear > 0.0f)
+        cutoff = -c / light.linear;
+    else
+        cutoff = 1e30f; // no falloff
+    return light.radius > 0.0f ? std::min(light.radius, cutoff) : cutoff;
+}
+
+class LightClusters
+{
+public:
+    size_t lightCount;
+    size_t indexCount; // light references over all clusters
+
+    LightClusters() : lightCount(0), indexCount(0), maxTexels(0), overflowReported(false),
+                      cachedNear(0.0f), cachedFar(0.0f) {}
+
+    // Creates the buffers; the GL context must be current
+    void Init()
+    {
+        GLint limit = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &limit);
+        maxTexels = (size_t)std::max(limit, 65536);
+
+        createBuffer(lightDataBuffer, lightDataTexture, GL_RGBA32F);
+        createBuffer(gridBuffer, gridTexture, GL_RG32UI);
+        createBuffer(indexBuffer, indexTexture, GL_R32UI);
+    }
+
+    // Points the program's cluster samplers at their texture units. Once per
+    // program, like SceneUniformBlocks::Bind.
+    static void SetSamplers(Shader& shader)
+    {
+        shader.use();
+        shader.setInt("lightData", LIGHT_DATA_TEXTURE_UNIT);
+        shader.setInt("clusterGrid", CLUSTER_GRID_TEXTURE_UNIT);
+        shader.setInt("clusterLights", CLUSTER_LIGHTS_TEXTURE_UNIT);
+    }
+
+    // Assigns the lights to clusters for this camera and uploads the lists.
+    // Clusters span [nearPlane, farPlane] in view depth; fragments past
+    // farPlane use the last slice. Radii are clamped to farPlane (the fog end
+    // in main.cpp): nothing past it is visible, and an unclamped light would
+    // touch every cluster.
+    void Update(const std::vector<ScenePointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+                float nearPlane, float farPlane, int viewportWidth, int viewportHeight)
+    {
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+        this->depthScale = LIGHT_CLUSTERS_Z / std::log(farPlane / nearPlane);
+        this->tileSize = glm::vec2((float)std::max(viewportWidth, 1) / LIGHT_CLUSTERS_X,
+                                   (float)std::max(viewportHeight, 1) / LIGHT_CLUSTERS_Y);
+        if (projection != this->cachedProjection || nearPlane != this->cachedNear || farPlane != this->cachedFar)
+            computeBounds(projection);
+
+        float px = projection[0][0];
+        float py = projection[1][1];
+
+        this->radii.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++) {
+            this->radii[i] = std::min(PointLightRadius(lights[i]), farPlane);
+        }
+
+        this->assignments.clear();
+        this->counts.assign(LIGHT_CLUSTER_COUNT, 0);
+        bool overflow = false;
+        for (size_t i = 0; i < lights.size() && !overflow; i++) {
+            float radius = this->radii[i];
+            if (radius <= 0.0f)
+                continue;
+            glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+            float depth = -center.z;
+            float nearest = depth - radius;
+            float farthest = depth + radius;
+            if (farthest < nearPlane || nearest > farPlane)
+                continue;
+
+            int z0 = slice(nearest);
+            int z1 = slice(farthest);
+            int x0 = 0, x1 = LIGHT_CLUSTERS_X - 1;
+            int y0 = 0, y1 = LIGHT_CLUSTERS_Y - 1;
+            // Screen bounds of the sphere's box; a sphere crossing the near
+            // plane can cover any tile
+            if (nearest > nearPlane) {
+                x0 = tile(std::min((center.x - radius) * px / nearest, (center.x - radius) * px / farthest), LIGHT_CLUSTERS_X);
+                x1 = tile(std::max((center.x + radius) * px / nearest, (center.x + radius) * px / farthest), LIGHT_CLUSTERS_X);
+                y0 = tile(std::min((center.y - radius) * py / nearest, (center.y - radius) * py / farthest), LIGHT_CLUSTERS_Y);
+                y1 = tile(std::max((center.y + radius) * py / nearest, (center.y + radius) * py / farthest), LIGHT_CLUSTERS_Y);
+            }
+
+            for (int z = z0; z <= z1 && !overflow; z++)
+                for (int y = y0; y <= y1 && !overflow; y++)
+                    for (int x = x0; x <= x1; x++) {
+                        int cluster = (z * LIGHT_CLUSTERS_Y + y) * LIGHT_CLUSTERS_X + x;
+                        if (!sphereTouchesBox(center, radius, this->boundsMin[cluster], this->boundsMax[cluster]))
+                            continue;
+                        if (this->assignments.size() >= this->maxTexels) {
+                            overflow = true;
+                            break;
+                        }
+                        this->assignments.push_back(Assignment{ (uint32_t)cluster, (uint32_t)i });
+                        this->counts[cluster]++;
+                    }
+        }
+        if (overflow && !this->overflowReported) {
+            std::cout << "WARNING::LIGHT_CLUSTERS:: More light references than a texture buffer holds, some lights are dropped" << std::endl;
+            this->overflowReported = true;
+        }
+
+        // Each cluster's list is a contiguous run of the index buffer, in
+        // light order because the assignments were made in that order
+        this->grid.resize(LIGHT_CLUSTER_COUNT * 2);
+        uint32_t offset = 0;
+        for (int c = 0; c < LIGHT_CLUSTER_COUNT; c++) {
+            this->grid[c * 2] = offset;
+            this->grid[c * 2 + 1] = this->counts[c];
+            offset += this->counts[c];
+            this->counts[c] = this->grid[c * 2];
+        }
+        this->indices.resize(this->assignments.size());
+        for (const Assignment& a : this->assignments)
+            this->indices[this->counts[a.cluster]++] = a.light;
+
+        // 4 texels per light: (position, radius) (ambient, constant) (diffuse, linear) (specular, quadratic)
+        this->lightTexels.resize(lights.size() * 4);
+        for (size_t i = 0; i < lights.size(); i++) {
+            const ScenePointLight& light = lights[i];
+            this->lightTexels[i * 4 + 0] = glm::vec4(light.position, this->radii[i]);
+            this->lightTexels[i * 4 + 1] = glm::vec4(light.ambient, light.constant);
+            this->lightTexels[i * 4 + 2] = glm::vec4(light.diffuse, light.linear);
+            this->lightTexels[i * 4 + 3] = glm::vec4(light.specular, light.quadratic);
+        }
+
+        upload(this->lightDataBuffer, this->lightTexels.data(), this->lightTexels.size() * sizeof(glm::vec4));
+        upload(this->gridBuffer, this->grid.data(), this->grid.size() * sizeof(uint32_t));
+        upload(this->indexBuffer, this->indices.data(), this->indices.size() * sizeof(uint32_t));
+
+        this->lightCount = lights.size();
+        this->indexCount = this->indices.size();
+    }
+
+    // Grid parameters the shaders need to find a fragment's cluster
+    void FillBlock(LightsBlock& block) const
+    {
+        block.clusterTileSize = this->tileSize;
+        block.clusterNear = this->nearPlane;
+        block.clusterDepthScale = this->depthScale;
+        block.clusterCountX = LIGHT_CLUSTERS_X;
+        block.clusterCountY = LIGHT_CLUSTERS_Y;
+        block.clusterCountZ = LIGHT_CLUSTERS_Z;
+    }
+
+    // Binds the three buffers to their texture units
+    void Bind() const
+    {
+        GLState().ActiveTexture(GL_TEXTURE0 + LIGHT_DATA_TEXTURE_UNIT);
+        GLState().BindTexture(GL_TEXTURE_BUFFER, this->lightDataTexture);
+        GLState().ActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_TEXTURE_UNIT);
+        GLState().BindTexture(GL_TEXTURE_BUFFER, this->gridTexture);
+        GLState().ActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHTS_TEXTURE_UNIT);
+        GLState().BindTexture(GL_TEXTURE_BUFFER, this->indexTexture);
+        GLState().ActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    struct Assignment {
+        uint32_t cluster;
+        uint32_t light;
+    };
+
+    GLuint lightDataBuffer, lightDataTexture;
+    GLuint gridBuffer, gridTexture;
+    GLuint indexBuffer, indexTexture;
+    size_t maxTexels;
+    bool overflowReported;
+
+    float nearPlane, farPlane, depthScale;
+    glm::vec2 tileSize;
+    glm::mat4 cachedProjection;
+    float cachedNear, cachedFar;
+    // View-space box of every cluster, rebuilt when the projection changes
+    std::vector<glm::vec3> boundsMin, boundsMax;
+
+    // Per-frame scratch, kept to avoid reallocating
+    std::vector<Assignment> assignments;
+    std::vector<float> radii;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec4> lightTexels;
+
+    static void createBuffer(GLuint& buffer, GLuint& texture, GLenum format)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+        glGenTextures(1, &texture);
+        GLState().BindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        GLState().BindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Orphans the old store so the upload never waits on a frame in flight.
+    // The texture stays attached to the buffer name across reallocations.
+    static void upload(GLuint buffer, const void* data, size_t bytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max(bytes, (size_t)16), NULL, GL_STREAM_DRAW);
+        if (bytes > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Same formula as the shaders' cluster lookup
+    int slice(float depth) const
+    {
+        if (depth <= this->nearPlane)
+            return 0;
+        int s = (int)(std::log(depth / this->nearPlane) * this->depthScale);
+        return std::min(std::max(s, 0), LIGHT_CLUSTERS_Z - 1);
+    }
+
+    static int tile(float ndc, int count)
+    {
+        int t = (int)std::floor((ndc * 0.5f + 0.5f) * count);
+        return std::min(std::max(t, 0), count - 1);
+    }
+
+    // Assumes a symmetric perspective projection (glm::perspective)
+    void computeBounds(const glm::mat4& projection)
+    {
+        this->cachedProjection = projection;
+        this->cachedNear = this->nearPlane;
+        this->cachedFar = this->farPlane;
+        this->boundsMin.resize(LIGHT_CLUSTER_COUNT);
+        this->boundsMax.resize(LIGHT_CLUSTER_COUNT);
+        float px = projection[0][0];
+        float py = projection[1][1];
+        for (int z = 0; z < LIGHT_CLUSTERS_Z; z++) {
+            float nearDepth = this->nearPlane * std::pow(this->farPlane / this->nearPlane, (float)z / LIGHT_CLUSTERS_Z);
+            float farDepth = this->nearPlane * std::pow(this->farPlane / this->nearPlane, (float)(z + 1) / LIGHT_CLUSTERS_Z);
+            for (int y = 0; y < LIGHT_CLUSTERS_Y; y++) {
+                float y0 = (2.0f * y / LIGHT_CLUSTERS_Y - 1.0f) / py;
+                float y1 = (2.0f * (y + 1) / LIGHT_CLUSTERS_Y - 1.0f) / py;
+                for (int x = 0; x < LIGHT_CLUSTERS_X; x++) {
+                    float x0 = (2.0f * x / LIGHT_CLUSTERS_X - 1.0f) / px;
+                    float x1 = (2.0f * (x + 1) / LIGHT_CLUSTERS_X - 1.0f) / px;
+                    // The tile's side planes through the slice's two depths
+                    int cluster = (z * LIGHT_CLUSTERS_Y + y) * LIGHT_CLUSTERS_X + x;
+                    this->boundsMin[cluster] = glm::vec3(std::min(x0 * nearDepth, x0 * farDepth),
+                                                         std::min(y0 * nearDepth, y0 * farDepth), -farDepth);
+                    this->boundsMax[cluster] = glm::vec3(std::max(x1 * nearDepth, x1 * farDepth),
+                                                         std::max(y1 * nearDepth, y1 * farDepth), -nearDepth);
+                }
+            }
+        }
+    }
+
+    static bool sphereTouchesBox(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+        glm::vec3 d = center - closest;
+        return glm::dot(d, d) <= radius * radius;
+    }
+};
+
+#endif
@@ -1,43 +1,47 @@
 #ifndef LIGHTING_H
 #define LIGHTING_H
 
-#include "engine/shader.h"
+#include "engine/uniform_blocks.h"
+#include "engine/light_clusters.h"
 #include "game_item.h"
 #include "player.h"
 #include <vector>
 #include <string>
 
-inline void SetupSceneLighting(Shader& shader, const std::vector<Item>& items, const glm::vec3& sunPos, Player& player) {
-    shader.setFloat("brightness", 1.0f);
+// Fills the Lights block (see uniform_blocks.h) for this frame and collects
+// every light item into pointLights for LightClusters::Update
+inline void SetupSceneLighting(LightsBlock& lights, std::vector<ScenePointLight>& pointLights, const std::vector<Item>& items, const glm::vec3& sunPos, const Player& player) {
+    lights.brightness = 1.0f;
 
     // 1. Directional light (Sun)
-    shader.setVec3("dirLight.direction", -sunPos);
-    shader.setVec3("dirLight.ambient", 0.2f, 0.2f, 0.2f);
-    shader.setVec3("dirLight.diffuse", 0.6f, 0.6f, 0.6f);
-    shader.setVec3("dirLight.specular", 0.6f, 0.6f, 0.6f);
+    lights.dirLight.direction = -sunPos;
+    lights.dirLight.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+    lights.dirLight.diffuse = glm::vec3(0.6f, 0.6f, 0.6f);
+    lights.dirLight.specular = glm::vec3(0.6f, 0.6f, 0.6f);
 
     // 2. Point lights
-    int lightCount = 0;
+    pointLights.clear();
     for(const auto& item : items) {
-        if(item.isLightSource && lightCount < 20) {
-            std::string number = std::to_string(lightCount);
-            shader.setVec3("pointLights[" + number + "].position", item.position);
+        if(item.isLightSource) {
+            ScenePointLight light;
+            light.position = item.position;
             
             // Use item color for light color, with increased intensity to cut through fog
-            shader.setVec3("pointLights[" + number + "].ambient", item.color * 0.1f);
-            shader.setVec3("pointLights[" + number + "].diffuse", item.color * 1.5f); 
-            shader.setVec3("pointLights[" + number + "].specular", item.color * 2.0f);
+            light.ambient = item.color * 0.1f;
+            light.diffuse = item.color * 1.5f; 
+            light.specular = item.color * 2.0f;
             
-            shader.setFloat("pointLights[" + number + "].constant", 1.0f);
-            shader.setFloat("pointLights[" + number + "].linear", 0.007f);
-            shader.setFloat("pointLights[" + number + "].quadratic", 0.0002f);
-            lightCount++;
+            light.constant = 1.0f;
+            light.linear = 0.007f;
+            light.quadratic = 0.0002f;
+            // Reaches as far as its attenuation allows; LightClusters clamps that to the fog end
+            light.radius = 0.0f;
+            pointLights.push_back(light);
         }
     }
-    shader.setInt("nPointLights", lightCount);
 
     // 3. SpotLight (Flashlight)
-    player.SetSpotlight(shader);
+    player.SetSpotlight(lights.spotLight);
 }
 
 #endif
@@ -6,6 +6,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "engine/shader.h"
+#include "engine/gl_state.h"
+#include "engine/simplify.h"
 
 #include <string>
 #include <vector>
@@ -18,6 +20,13 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// Faixa de índices de um nível de detalhe dentro do EBO da mesh
+struct MeshLod {
+    unsigned int indexOffset; // em índices, não bytes
+    unsigned int indexCount;
+    float error;              // erro da simplificação (0 para o LOD 0)
+};
+
 struct Texture {
     unsigned int id;
     std::string type;
@@ -33,6 +42,11 @@ public:
     unsigned int VAO;
     glm::vec3 Center;
     float Radius;
+    // LOD 0 é a malha original; GenerateLods acrescenta versões simplificadas
+    // que compartilham o VBO e ficam depois dela no EBO
+    std::vector<MeshLod> Lods;
+    // Conteúdo do EBO: todas as faixas de Lods (indices é só o LOD 0)
+    std::vector<unsigned int> lodIndices;
 
     // Construtor
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
@@ -43,6 +57,41 @@ public:
 
         calculateBounds();
         setupMesh();
+        Lods.push_back(MeshLod{ 0, (unsigned int)this->indices.size(), 0.0f });
+        lodIndices = this->indices;
+    }
+
+    // Gera até levels níveis no total, cada um com cerca de metade dos
+    // triângulos do anterior, e reenvia o EBO com todas as faixas
+    void GenerateLods(int levels)
+    {
+        std::vector<glm::vec3> positions(vertices.size());
+        std::vector<glm::vec2> texCoords(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].Position;
+            texCoords[i] = vertices[i].TexCoords;
+        }
+
+        std::vector<unsigned int> allIndices = indices;
+        std::vector<unsigned int> previous = indices;
+        Lods.resize(1);
+        for (int level = 1; level < levels; level++) {
+            size_t target = previous.size() / 6 * 3;
+            float error = 0.0f;
+            std::vector<unsigned int> lod = SimplifyMesh(positions, texCoords, previous, target, &error);
+            // Parar quando a malha não reduz mais
+            if (lod.empty() || lod.size() * 10 > previous.size() * 9)
+                break;
+            Lods.push_back(MeshLod{ (unsigned int)allIndices.size(), (unsigned int)lod.size(), error });
+            allIndices.insert(allIndices.end(), lod.begin(), lod.end());
+            previous.swap(lod);
+        }
+
+        GLState().BindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int), &allIndices[0], GL_STATIC_DRAW);
+        GLState().BindVertexArray(0);
+        lodIndices.swap(allIndices);
     }
 
     void calculateBounds() {
@@ -79,16 +128,16 @@ public:
 
         if (overrideTextureID != 0)
         {
-            glActiveTexture(GL_TEXTURE0);
+            GLState().ActiveTexture(GL_TEXTURE0);
             shader.setInt("texture_diffuse1", 0);
-            glBindTexture(GL_TEXTURE_2D, overrideTextureID);
+            GLState().BindTexture(GL_TEXTURE_2D, overrideTextureID);
             hasDiffuse = true;
         }
         else
         {
             for(unsigned int i = 0; i < textures.size(); i++)
             {
-                glActiveTexture(GL_TEXTURE0 + i);
+                GLState().ActiveTexture(GL_TEXTURE0 + i);
                 std::string number;
                 std::string name = textures[i].type;
                 if(name == "texture_diffuse") {
@@ -105,7 +154,7 @@ public:
                     number = std::to_string(heightNr++);
 
                 shader.setInt((name + number).c_str(), i);
-                glBindTexture(GL_TEXTURE_2D, textures[i].id);
+                GLState().BindTexture(GL_TEXTURE_2D, textures[i].id);
             }
         }
 
@@ -118,30 +167,18 @@ public:
     {
         BindTextures(shader, overrideTextureID);
         // Desenhar mesh
-        glBindVertexArray(VAO);
+        GLState().BindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        glActiveTexture(GL_TEXTURE0);
+        GLState().BindVertexArray(0);
+        GLState().ActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    unsigned int VBO, EBO;
-
-    void setupMesh()
+    // Liga o VBO/EBO desta mesh e configura os atributos 0..4 no VAO atualmente
+    // ligado (usado também por VAOs extras que desenham a mesma geometria)
+    void BindVertexAttributes() const
     {
-        // Criar buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        
-        // Carregar dados nos vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
         // Configurar ponteiros de atributos de vértices
         // Posições dos vértices
@@ -163,8 +200,30 @@ private:
         // Bitangente dos vértices
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
+
+private:
+    unsigned int VBO, EBO;
+
+    void setupMesh()
+    {
+        // Criar buffers/arrays
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        GLState().BindVertexArray(VAO);
+        
+        // Carregar dados nos vertex buffers
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+        BindVertexAttributes();
 
-        glBindVertexArray(0);
+        GLState().BindVertexArray(0);
     }
 };
 
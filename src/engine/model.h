@@ -13,6 +13,7 @@
 
 #include "mesh.h"
 #include "engine/shader.h"
+#include "engine/gl_state.h"
 
 #include <string>
 #include <fstream>
@@ -23,6 +24,7 @@
    
 
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
+unsigned int TextureArrayFromFiles(const std::vector<std::string> &paths, const std::string &directory);
 
 class Model 
 {
@@ -42,6 +44,13 @@ public:
         loadModel(path, flipWindings);
     }
 
+    // Gera a cadeia de LODs de todas as meshes (ver Mesh::GenerateLods)
+    void GenerateLods(int levels)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].GenerateLods(levels);
+    }
+
     // Desenha o modelo e todas as suas meshes
     void Draw(Shader &shader)
     {
@@ -282,7 +291,7 @@ unsigned int TextureFromFile(const char *path, const std::string &directory, boo
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState().BindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -303,4 +312,49 @@ unsigned int TextureFromFile(const char *path, const std::string &directory, boo
     return textureID;
 }
 
+// Carrega várias imagens do mesmo tamanho como camadas de uma GL_TEXTURE_2D_ARRAY
+// (a camada i é paths[i]). Imagens com tamanho diferente da primeira ficam pretas.
+unsigned int TextureArrayFromFiles(const std::vector<std::string> &paths, const std::string &directory)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState().BindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+    int layerWidth = 0, layerHeight = 0;
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        std::string filename = directory + '/' + paths[i];
+        int width, height, nrComponents;
+        // Sempre RGBA, para todas as camadas terem o mesmo formato
+        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 4);
+        if (!data)
+        {
+            std::cout << "ERRO: Falha ao carregar textura: " << filename << std::endl;
+            std::cout << "Motivo: " << stbi_failure_reason() << std::endl;
+            continue;
+        }
+        if (layerWidth == 0)
+        {
+            layerWidth = width;
+            layerHeight = height;
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, (GLsizei)paths.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        if (width == layerWidth && height == layerHeight)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        else
+            std::cout << "ERRO: Textura com tamanho diferente das outras camadas: " << filename << std::endl;
+        stbi_image_free(data);
+    }
+
+    if (layerWidth > 0)
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLState().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return textureID;
+}
+
 #endif
@@ -6,16 +6,25 @@
 #include <vector>
 #include <cmath>
 
-inline void renderSphere()
+#include "engine/gl_state.h"
+
+// Unit sphere shared by renderSphere and instanced renderers: positions (0),
+// normals (1) and uvs (2), drawn as one GL_TRIANGLE_STRIP
+struct SphereGeometry {
+    unsigned int VAO, VBO, EBO;
+    unsigned int indexCount;
+};
+
+inline const SphereGeometry& GetSphereGeometry()
 {
-    static unsigned int sphereVAO = 0;
-    static unsigned int indexCount = 0;
+    static SphereGeometry sphere = { 0, 0, 0, 0 };
 
-    if (sphereVAO == 0)
+    if (sphere.VAO == 0)
     {
-        glGenVertexArrays(1, &sphereVAO);
+        glGenVertexArrays(1, &sphere.VAO);
 
-        unsigned int vbo, ebo;
+        unsigned int& vbo = sphere.VBO;
+        unsigned int& ebo = sphere.EBO;
         glGenBuffers(1, &vbo);
         glGenBuffers(1, &ebo);
 
@@ -65,7 +74,7 @@ inline void renderSphere()
             }
             oddRow = !oddRow;
         }
-        indexCount = static_cast<unsigned int>(indices.size());
+        sphere.indexCount = static_cast<unsigned int>(indices.size());
 
         std::vector<float> data;
         for (unsigned int i = 0; i < positions.size(); ++i)
@@ -85,7 +94,7 @@ inline void renderSphere()
                 data.push_back(uv[i].y);
             }
         }
-        glBindVertexArray(sphereVAO);
+        GLState().BindVertexArray(sphere.VAO);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
@@ -97,11 +106,18 @@ inline void renderSphere()
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+        GLState().BindVertexArray(0);
     }
 
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    return sphere;
+}
+
+inline void renderSphere()
+{
+    const SphereGeometry& sphere = GetSphereGeometry();
+    GLState().BindVertexArray(sphere.VAO);
+    glDrawElements(GL_TRIANGLE_STRIP, sphere.indexCount, GL_UNSIGNED_INT, 0);
+    GLState().BindVertexArray(0);
 }
 
 inline void renderCone()
@@ -171,7 +187,7 @@ inline void renderCone()
 
         indexCount = indices.size();
 
-        glBindVertexArray(coneVAO);
+        GLState().BindVertexArray(coneVAO);
 
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3) + normals.size() * sizeof(glm::vec3) + uv.size() * sizeof(glm::vec2), NULL, GL_STATIC_DRAW);
@@ -192,12 +208,12 @@ inline void renderCone()
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)(positions.size() * sizeof(glm::vec3) + normals.size() * sizeof(glm::vec3)));
 
-        glBindVertexArray(0);
+        GLState().BindVertexArray(0);
     }
 
-    glBindVertexArray(coneVAO);
+    GLState().BindVertexArray(coneVAO);
     glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    GLState().BindVertexArray(0);
 }
 
 inline void renderCube()
@@ -258,7 +274,7 @@ inline void renderCube()
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
         // link vertex attributes
-        glBindVertexArray(cubeVAO);
+        GLState().BindVertexArray(cubeVAO);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(1);
@@ -266,12 +282,12 @@ inline void renderCube()
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        GLState().BindVertexArray(0);
     }
     // render Cube
-    glBindVertexArray(cubeVAO);
+    GLState().BindVertexArray(cubeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    GLState().BindVertexArray(0);
 }
 
 inline void renderQuad()
@@ -291,7 +307,7 @@ inline void renderQuad()
         // setup plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        GLState().BindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -299,9 +315,9 @@ inline void renderQuad()
         glEnableVertexAttribArray(2); // TexCoords at location 2 to match other primitives
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
+    GLState().BindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    GLState().BindVertexArray(0);
 }
 
 #endif
@@ -0,0 +1,74 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). Output is a pure function of (key, counter),
+// so any number of independent streams can be created from one seed and
+// used from different threads without shared state.
+inline void Philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)M0 * c0;
+        uint64_t p1 = (uint64_t)M1 * c2;
+        uint32_t hi0 = (uint32_t)(p0 >> 32), lo0 = (uint32_t)p0;
+        uint32_t hi1 = (uint32_t)(p1 >> 32), lo1 = (uint32_t)p1;
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += W0;
+        k1 += W1;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+// One random stream: the seed is the Philox key, the stream id fills the upper
+// half of the counter and the lower half counts generated blocks.
+class Random {
+public:
+    Random(uint64_t seed = 0, uint64_t stream = 0) : block(0), used(4) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        streamLo = (uint32_t)stream;
+        streamHi = (uint32_t)(stream >> 32);
+    }
+
+    uint32_t NextUInt() {
+        if (used == 4) {
+            uint32_t counter[4] = { (uint32_t)block, (uint32_t)(block >> 32), streamLo, streamHi };
+            Philox4x32(counter, key, buffer);
+            block++;
+            used = 0;
+        }
+        return buffer[used++];
+    }
+
+    // Uniform in [0, 1)
+    float NextFloat() {
+        return (NextUInt() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float Range(float lo, float hi) {
+        return lo + NextFloat() * (hi - lo);
+    }
+
+    // Uniform integer in [0, n)
+    int RangeInt(int n) {
+        if (n <= 0) return 0;
+        return (int)(((uint64_t)NextUInt() * (uint64_t)n) >> 32);
+    }
+
+private:
+    uint32_t key[2];
+    uint32_t streamLo, streamHi;
+    uint64_t block;
+    uint32_t buffer[4];
+    int used;
+};
+
+#endif
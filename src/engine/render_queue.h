@@ -0,0 +1,150 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "engine/shader.h"
+
+// Draws of a frame are submitted with a 64-bit sort key and issued in key
+// order by Flush. The key packs, from the top bit down:
+//
+//   opaque:      pass(2) layer(2) program(8) material(16) depth(24)
+//   transparent: pass(2) layer(2) far-to-near depth(24) program(8) material(16)
+//
+// so opaque draws are grouped by program and material and go front-to-back
+// inside each group (early-Z rejects the hidden fragments before the lighting
+// loop runs), the sky fills whatever is left after them, and transparent
+// draws blend back-to-front. Program order between groups is arbitrary; a
+// draw that must fill the depth buffer before the others (the ship) goes in
+// the foreground layer instead. Draws with equal keys keep submission order.
+// Each pass is flushed on its own, so the frame graph can give every pass
+// its own render target.
+
+enum RenderPass {
+    RENDER_PASS_SCENE = 0,
+    RENDER_PASS_OVERLAY = 1 // HUD, after the whole scene
+};
+
+enum RenderLayer {
+    RENDER_LAYER_FOREGROUND = 0, // opaque, before all other opaque draws
+    RENDER_LAYER_OPAQUE = 1,
+    RENDER_LAYER_SKY = 2,
+    RENDER_LAYER_TRANSPARENT = 3
+};
+
+class RenderQueue
+{
+public:
+    typedef std::function<void()> DrawFn;
+
+    size_t drawCount; // draws issued during the last frame
+
+    RenderQueue() : drawCount(0), issued(0), eye(0.0f), farPlane(1.0f) {}
+
+    // Starts a frame; depths are measured from eye and clamped to farPlane
+    void Begin(const glm::vec3& eye, float farPlane)
+    {
+        this->eye = eye;
+        this->farPlane = farPlane;
+        this->commands.clear();
+        this->drawCount = this->issued;
+        this->issued = 0;
+    }
+
+    void Submit(uint64_t key, DrawFn draw)
+    {
+        this->commands.push_back(Command{ key, std::move(draw) });
+    }
+
+    // Key of an opaque draw bounded by the sphere (center, radius). material
+    // is any id shared by draws that bind the same textures.
+    uint64_t OpaqueKey(const Shader& shader, uint32_t material, const glm::vec3& center, float radius) const
+    {
+        return opaqueKey(RENDER_LAYER_OPAQUE, shader, material, center, radius);
+    }
+
+    // Like OpaqueKey, but sorts before every other opaque draw whatever its
+    // program. For large occluders close to the camera.
+    uint64_t ForegroundKey(const Shader& shader, uint32_t material, const glm::vec3& center, float radius) const
+    {
+        return opaqueKey(RENDER_LAYER_FOREGROUND, shader, material, center, radius);
+    }
+
+    // Key of a blended draw. Sorting uses the sphere's nearest point rather
+    // than its center, so a shell drawn around another effect (the shield
+    // around the engine plume) blends over it.
+    uint64_t TransparentKey(const Shader& shader, uint32_t material, const glm::vec3& center, float radius) const
+    {
+        return header(RENDER_PASS_SCENE, RENDER_LAYER_TRANSPARENT) |
+               ((uint64_t)(DEPTH_MAX - depth(center, radius)) << 36) |
+               ((uint64_t)(shader.ID & 0xFF) << 28) |
+               ((uint64_t)(material & 0xFFFF) << 12);
+    }
+
+    // The sky goes after every opaque draw, at the far plane with GL_LEQUAL
+    static uint64_t SkyKey()
+    {
+        return header(RENDER_PASS_SCENE, RENDER_LAYER_SKY);
+    }
+
+    // HUD draws run after the scene, in submission order
+    static uint64_t OverlayKey()
+    {
+        return header(RENDER_PASS_OVERLAY, RENDER_LAYER_OPAQUE);
+    }
+
+    // Sorts and issues the pass's draws, then drops them from the queue
+    void Flush(RenderPass pass)
+    {
+        std::stable_sort(this->commands.begin(), this->commands.end(),
+                         [](const Command& a, const Command& b) { return a.key < b.key; });
+        auto first = std::find_if(this->commands.begin(), this->commands.end(),
+                                  [pass](const Command& c) { return (RenderPass)(c.key >> 62) == pass; });
+        auto last = std::find_if(first, this->commands.end(),
+                                 [pass](const Command& c) { return (RenderPass)(c.key >> 62) != pass; });
+        for (auto it = first; it != last; ++it)
+            it->draw();
+        this->issued += last - first;
+        this->commands.erase(first, last);
+    }
+
+private:
+    struct Command {
+        uint64_t key;
+        DrawFn draw;
+    };
+
+    static const uint32_t DEPTH_MAX = 0xFFFFFF;
+
+    std::vector<Command> commands;
+    size_t issued;
+    glm::vec3 eye;
+    float farPlane;
+
+    static uint64_t header(RenderPass pass, RenderLayer layer)
+    {
+        return ((uint64_t)pass << 62) | ((uint64_t)layer << 60);
+    }
+
+    uint64_t opaqueKey(RenderLayer layer, const Shader& shader, uint32_t material, const glm::vec3& center, float radius) const
+    {
+        return header(RENDER_PASS_SCENE, layer) |
+               ((uint64_t)(shader.ID & 0xFF) << 52) |
+               ((uint64_t)(material & 0xFFFF) << 36) |
+               ((uint64_t)depth(center, radius) << 12);
+    }
+
+    // Distance to the sphere's nearest point, quantized to 24 bits
+    uint32_t depth(const glm::vec3& center, float radius) const
+    {
+        float d = glm::length(center - this->eye) - radius;
+        float t = glm::clamp(d / this->farPlane, 0.0f, 1.0f);
+        return (uint32_t)(t * DEPTH_MAX);
+    }
+};
+
+#endif
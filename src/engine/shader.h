@@ -3,11 +3,26 @@
 
 #include "libs/glad.h"
 #include <glm/glm.hpp>
+#include "engine/gl45.h"
+#include "engine/gl_state.h"
 
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <unordered_map>
+
+// Localização de um uniform num programa, resolvida uma vez com Shader::handle
+// e depois passada aos setters no lugar do nome (sem busca por frame)
+struct UniformHandle
+{
+    GLint location;
+
+    UniformHandle() : location(-1) {}
+    explicit UniformHandle(GLint location) : location(location) {}
+};
 
 class Shader
 {
@@ -16,56 +31,12 @@ public:
 
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+        std::string vertexCode = readFile(vertexPath);
+        std::string fragmentCode = readFile(fragmentPath);
 
-        // Garantir que ifstream pode lançar exceções
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        
-        try 
-        {
-            // Abrir arquivos
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            
-            // Ler conteúdo dos arquivos nos streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            
-            // Fechar arquivos
-            vShaderFile.close();
-            fShaderFile.close();
-            
-            // Converter stream em string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERRO::SHADER::ARQUIVO_NAO_LIDO_COM_SUCESSO" << std::endl;
-        }
-        
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        
         // 2. Compilar shaders
-        unsigned int vertex, fragment;
-        
-        // Vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        
-        // Fragment shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        unsigned int vertex = compileStage(GL_VERTEX_SHADER, vertexCode, "VERTEX");
+        unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode, "FRAGMENT");
         
         // Programa shader
         ID = glCreateProgram();
@@ -73,50 +44,261 @@ public:
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
         
         // Deletar shaders após linkar
         glDeleteShader(vertex);
         glDeleteShader(fragment);
     }
 
+    // Programa sem fragment shader para transform feedback: as saídas listadas
+    // em feedbackVaryings são gravadas intercaladas (GL_INTERLEAVED_ATTRIBS)
+    // no buffer ligado em GL_TRANSFORM_FEEDBACK_BUFFER
+    Shader(const char* vertexPath, const char* geometryPath, const std::vector<const char*>& feedbackVaryings)
+    {
+        std::string vertexCode = readFile(vertexPath);
+        std::string geometryCode = readFile(geometryPath);
+
+        unsigned int vertex = compileStage(GL_VERTEX_SHADER, vertexCode, "VERTEX");
+        unsigned int geometry = compileStage(GL_GEOMETRY_SHADER, geometryCode, "GEOMETRY");
+
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, geometry);
+        // Precisa ser definido antes de linkar
+        glTransformFeedbackVaryings(ID, (GLsizei)feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
+
+        glDeleteShader(vertex);
+        glDeleteShader(geometry);
+    }
+
+    // Programa com um único compute shader (exige contexto 4.3+, ver gl45.h)
+    explicit Shader(const char* computePath)
+    {
+        std::string computeCode = readFile(computePath);
+        unsigned int compute = compileStage(GL_COMPUTE_SHADER, computeCode, "COMPUTE");
+
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
+
+        glDeleteShader(compute);
+    }
+
     // Ativar o shader
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState().UseProgram(ID); 
+    }
+
+    // Liga o uniform block `name` ao binding point (GLSL 3.30 não tem
+    // layout(binding = N)); não faz nada se o programa não declara o bloco
+    void bindUniformBlock(const std::string &name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+
+    // Localização de um uniform ativo (-1 se não existir ou foi otimizado fora),
+    // da tabela montada ao linkar; não chama o driver
+    UniformHandle handle(const std::string &name) const
+    {
+        return UniformHandle(location(name));
     }
 
     // Funções utilitárias para configurar uniforms
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(location(name), (int)value); 
     }
     
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location(name), value); 
     }
     
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(location(name), value); 
+    }
+    
+    void setVec2(const std::string &name, float x, float y) const
+    { 
+        glUniform2f(location(name), x, y); 
     }
     
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location(name), 1, &value[0]); 
     }
     
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(location(name), x, y, z); 
+    }
+    
+    void setVec4Array(const std::string &name, const glm::vec4* values, int count) const
+    { 
+        glUniform4fv(location(name), count, &values[0][0]); 
     }
     
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // Mesmos setters com a localização já resolvida (programa em uso)
+    void setBool(UniformHandle uniform, bool value) const
+    {
+        glUniform1i(uniform.location, (int)value);
+    }
+
+    void setInt(UniformHandle uniform, int value) const
+    {
+        glUniform1i(uniform.location, value);
+    }
+
+    void setFloat(UniformHandle uniform, float value) const
+    {
+        glUniform1f(uniform.location, value);
+    }
+
+    void setVec2(UniformHandle uniform, float x, float y) const
+    {
+        glUniform2f(uniform.location, x, y);
+    }
+
+    void setVec3(UniformHandle uniform, const glm::vec3 &value) const
+    {
+        glUniform3fv(uniform.location, 1, &value[0]);
+    }
+
+    void setVec3(UniformHandle uniform, float x, float y, float z) const
+    {
+        glUniform3f(uniform.location, x, y, z);
+    }
+
+    void setVec4Array(UniformHandle uniform, const glm::vec4* values, int count) const
+    {
+        glUniform4fv(uniform.location, count, &values[0][0]);
+    }
+
+    // Arrays inteiros numa chamada, a partir do handle do nome base ("nome")
+    void setIntArray(UniformHandle uniform, const int* values, int count) const
+    {
+        glUniform1iv(uniform.location, count, values);
+    }
+
+    void setFloatArray(UniformHandle uniform, const float* values, int count) const
+    {
+        glUniform1fv(uniform.location, count, values);
+    }
+
+    void setVec3Array(UniformHandle uniform, const glm::vec3* values, int count) const
+    {
+        glUniform3fv(uniform.location, count, &values[0][0]);
+    }
+
+    void setMat4(UniformHandle uniform, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // Localizações dos uniforms ativos, indexadas pelo hash FNV-1a do nome
+    std::unordered_map<uint64_t, GLint> uniformLocations;
+
+    static uint64_t hashName(const std::string& name)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : name) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    GLint location(const std::string& name) const
+    {
+        auto it = uniformLocations.find(hashName(name));
+        return it == uniformLocations.end() ? -1 : it->second;
+    }
+
+    void addUniform(const std::string& name, GLint location)
+    {
+        auto result = uniformLocations.emplace(hashName(name), location);
+        if (!result.second && result.first->second != location)
+            std::cout << "ERRO::SHADER::COLISAO_DE_HASH_DE_UNIFORM: " << name << std::endl;
+    }
+
+    // Lê todos os uniforms ativos depois de linkar. Arrays aparecem como
+    // "nome[0]"; "nome" e cada elemento "nome[k]" também são registrados.
+    // Membros de uniform blocks não têm localização e ficam de fora.
+    void reflectUniforms()
+    {
+        uniformLocations.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            GLint uniformLocation = glGetUniformLocation(ID, name.c_str());
+            if (uniformLocation < 0) continue;
+            addUniform(name, uniformLocation);
+
+            size_t bracket = name.size() >= 3 ? name.size() - 3 : std::string::npos;
+            if (bracket == std::string::npos || name.compare(bracket, 3, "[0]") != 0) continue;
+            std::string base = name.substr(0, bracket);
+            addUniform(base, uniformLocation);
+            for (GLint k = 1; k < size; k++) {
+                std::string element = base + "[" + std::to_string(k) + "]";
+                addUniform(element, glGetUniformLocation(ID, element.c_str()));
+            }
+        }
+    }
+
+    // Ler o código fonte de um arquivo
+    static std::string readFile(const char* path)
+    {
+        std::ifstream file;
+        // Garantir que ifstream pode lançar exceções
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try 
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERRO::SHADER::ARQUIVO_NAO_LIDO_COM_SUCESSO" << std::endl;
+        }
+        return std::string();
+    }
+
+    unsigned int compileStage(GLenum type, const std::string& code, const std::string& name)
+    {
+        const char* source = code.c_str();
+        unsigned int stage = glCreateShader(type);
+        glShaderSource(stage, 1, &source, NULL);
+        glCompileShader(stage);
+        checkCompileErrors(stage, name);
+        return stage;
+    }
+
     // Verificar erros de compilação/linkagem
     void checkCompileErrors(GLuint shader, std::string type)
     {
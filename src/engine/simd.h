@@ -0,0 +1,314 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define SIMD_X86 1
+    #define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+    #include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define SIMD_X86 1
+    #define SIMD_TARGET_AVX2
+    #include <immintrin.h>
+    #include <intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <malloc.h>
+#endif
+
+// Alignment of every SoA array: one AVX register
+const size_t SIMD_ALIGNMENT = 32;
+
+// std::allocator replacement that hands out SIMD_ALIGNMENT-aligned storage
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() {}
+    template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        bytes = (bytes + SIMD_ALIGNMENT - 1) & ~(SIMD_ALIGNMENT - 1);
+#if defined(_MSC_VER)
+        void* p = _aligned_malloc(bytes, SIMD_ALIGNMENT);
+#else
+        void* p = std::aligned_alloc(SIMD_ALIGNMENT, bytes);
+#endif
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) {
+#if defined(_MSC_VER)
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<float, AlignedAllocator<float> > AlignedFloats;
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE,
+    SIMD_AVX2
+};
+
+inline SimdLevel DetectSimdLevel() {
+#if defined(__GNUC__) && defined(SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE;
+#elif defined(_MSC_VER) && defined(SIMD_X86)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return SIMD_AVX2;
+    }
+    if (sse2) return SIMD_SSE;
+#endif
+    return SIMD_SCALAR;
+}
+
+// Kernels
+//   AddScaled:            dst[i] += src[i] * scale
+//   IntegrateQuaternions: q[i] += 0.5 * dt * (w[i] * q[i]), then renormalize,
+//                         with w a world-space angular velocity in radians/s
+//   CullSpheres:          flags[i] = CULL_IN_FRUSTUM if sphere i is not fully behind
+//                         any of the 6 planes (xyzw each), | CULL_IN_RANGE if it
+//                         starts closer than maxDistance to eye
+
+enum CullFlags {
+    CULL_IN_FRUSTUM = 1,
+    CULL_IN_RANGE = 2
+};
+
+inline void AddScaledScalar(float* dst, const float* src, float scale, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        dst[i] += src[i] * scale;
+}
+
+inline void IntegrateQuaternionsScalar(float* qx, float* qy, float* qz, float* qw,
+                                       const float* wx, const float* wy, const float* wz, float dt, size_t n) {
+    float h = 0.5f * dt;
+    for (size_t i = 0; i < n; i++) {
+        float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+        float nx = x + h * ( wx[i] * w + wy[i] * z - wz[i] * y);
+        float ny = y + h * (-wx[i] * z + wy[i] * w + wz[i] * x);
+        float nz = z + h * ( wx[i] * y - wy[i] * x + wz[i] * w);
+        float nw = w + h * (-wx[i] * x - wy[i] * y - wz[i] * z);
+        float inv = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+        qx[i] = nx * inv; qy[i] = ny * inv; qz[i] = nz * inv; qw[i] = nw * inv;
+    }
+}
+
+inline void CullSpheresScalar(const float* planes, const float* eye, float maxDistance,
+                              const float* x, const float* y, const float* z, const float* r, unsigned char* flags, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char f = CULL_IN_FRUSTUM;
+        for (int p = 0; p < 6; p++) {
+            const float* pl = planes + p * 4;
+            if (pl[0] * x[i] + pl[1] * y[i] + pl[2] * z[i] + pl[3] < -r[i]) {
+                f = 0;
+                break;
+            }
+        }
+        float dx = x[i] - eye[0], dy = y[i] - eye[1], dz = z[i] - eye[2];
+        float reach = maxDistance + r[i];
+        if (dx * dx + dy * dy + dz * dz < reach * reach)
+            f |= CULL_IN_RANGE;
+        flags[i] = f;
+    }
+}
+
+#ifdef SIMD_X86
+inline void AddScaledSSE(float* dst, const float* src, float scale, size_t n) {
+    size_t i = 0;
+    __m128 s = _mm_set1_ps(scale);
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        __m128 v = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(v, s)));
+    }
+    AddScaledScalar(dst + i, src + i, scale, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void AddScaledAVX2(float* dst, const float* src, float scale, size_t n) {
+    size_t i = 0;
+    __m256 s = _mm256_set1_ps(scale);
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_loadu_ps(dst + i);
+        __m256 v = _mm256_loadu_ps(src + i);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(d, _mm256_mul_ps(v, s)));
+    }
+    AddScaledScalar(dst + i, src + i, scale, n - i);
+}
+
+inline void IntegrateQuaternionsSSE(float* qx, float* qy, float* qz, float* qw,
+                                    const float* wx, const float* wy, const float* wz, float dt, size_t n) {
+    size_t i = 0;
+    __m128 h = _mm_set1_ps(0.5f * dt);
+    __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(qx + i), y = _mm_loadu_ps(qy + i), z = _mm_loadu_ps(qz + i), w = _mm_loadu_ps(qw + i);
+        __m128 ax = _mm_mul_ps(h, _mm_loadu_ps(wx + i));
+        __m128 ay = _mm_mul_ps(h, _mm_loadu_ps(wy + i));
+        __m128 az = _mm_mul_ps(h, _mm_loadu_ps(wz + i));
+        __m128 nx = _mm_add_ps(x, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(ax, w), _mm_mul_ps(ay, z)), _mm_mul_ps(az, y)));
+        __m128 ny = _mm_add_ps(y, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ay, w), _mm_mul_ps(ax, z)), _mm_mul_ps(az, x)));
+        __m128 nz = _mm_add_ps(z, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ax, y), _mm_mul_ps(ay, x)), _mm_mul_ps(az, w)));
+        __m128 nw = _mm_sub_ps(w, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, x), _mm_mul_ps(ay, y)), _mm_mul_ps(az, z)));
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_add_ps(_mm_mul_ps(nz, nz), _mm_mul_ps(nw, nw)));
+        __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(len2));
+        _mm_storeu_ps(qx + i, _mm_mul_ps(nx, inv));
+        _mm_storeu_ps(qy + i, _mm_mul_ps(ny, inv));
+        _mm_storeu_ps(qz + i, _mm_mul_ps(nz, inv));
+        _mm_storeu_ps(qw + i, _mm_mul_ps(nw, inv));
+    }
+    IntegrateQuaternionsScalar(qx + i, qy + i, qz + i, qw + i, wx + i, wy + i, wz + i, dt, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void IntegrateQuaternionsAVX2(float* qx, float* qy, float* qz, float* qw,
+                                                      const float* wx, const float* wy, const float* wz, float dt, size_t n) {
+    size_t i = 0;
+    __m256 h = _mm256_set1_ps(0.5f * dt);
+    __m256 one = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(qx + i), y = _mm256_loadu_ps(qy + i), z = _mm256_loadu_ps(qz + i), w = _mm256_loadu_ps(qw + i);
+        __m256 ax = _mm256_mul_ps(h, _mm256_loadu_ps(wx + i));
+        __m256 ay = _mm256_mul_ps(h, _mm256_loadu_ps(wy + i));
+        __m256 az = _mm256_mul_ps(h, _mm256_loadu_ps(wz + i));
+        __m256 nx = _mm256_add_ps(x, _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(ax, w), _mm256_mul_ps(ay, z)), _mm256_mul_ps(az, y)));
+        __m256 ny = _mm256_add_ps(y, _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(ay, w), _mm256_mul_ps(ax, z)), _mm256_mul_ps(az, x)));
+        __m256 nz = _mm256_add_ps(z, _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(ax, y), _mm256_mul_ps(ay, x)), _mm256_mul_ps(az, w)));
+        __m256 nw = _mm256_sub_ps(w, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, x), _mm256_mul_ps(ay, y)), _mm256_mul_ps(az, z)));
+        __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_add_ps(_mm256_mul_ps(nz, nz), _mm256_mul_ps(nw, nw)));
+        __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(len2));
+        _mm256_storeu_ps(qx + i, _mm256_mul_ps(nx, inv));
+        _mm256_storeu_ps(qy + i, _mm256_mul_ps(ny, inv));
+        _mm256_storeu_ps(qz + i, _mm256_mul_ps(nz, inv));
+        _mm256_storeu_ps(qw + i, _mm256_mul_ps(nw, inv));
+    }
+    IntegrateQuaternionsScalar(qx + i, qy + i, qz + i, qw + i, wx + i, wy + i, wz + i, dt, n - i);
+}
+
+inline void CullSpheresSSE(const float* planes, const float* eye, float maxDistance,
+                           const float* x, const float* y, const float* z, const float* r, unsigned char* flags, size_t n) {
+    size_t i = 0;
+    __m128 ex = _mm_set1_ps(eye[0]), ey = _mm_set1_ps(eye[1]), ez = _mm_set1_ps(eye[2]);
+    __m128 range = _mm_set1_ps(maxDistance);
+    for (; i + 4 <= n; i += 4) {
+        __m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i), cr = _mm_loadu_ps(r + i);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), cr);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const float* pl = planes + p * 4;
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl[0]), cx), _mm_mul_ps(_mm_set1_ps(pl[1]), cy)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl[2]), cz), _mm_set1_ps(pl[3])));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+        }
+        __m128 dx = _mm_sub_ps(cx, ex), dy = _mm_sub_ps(cy, ey), dz = _mm_sub_ps(cz, ez);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 reach = _mm_add_ps(range, cr);
+        int inFrustum = _mm_movemask_ps(inside);
+        int inRange = _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(reach, reach)));
+        for (int k = 0; k < 4; k++)
+            flags[i + k] = (unsigned char)(((inFrustum >> k) & 1) * CULL_IN_FRUSTUM | ((inRange >> k) & 1) * CULL_IN_RANGE);
+    }
+    CullSpheresScalar(planes, eye, maxDistance, x + i, y + i, z + i, r + i, flags + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void CullSpheresAVX2(const float* planes, const float* eye, float maxDistance,
+                                             const float* x, const float* y, const float* z, const float* r, unsigned char* flags, size_t n) {
+    size_t i = 0;
+    __m256 ex = _mm256_set1_ps(eye[0]), ey = _mm256_set1_ps(eye[1]), ez = _mm256_set1_ps(eye[2]);
+    __m256 range = _mm256_set1_ps(maxDistance);
+    for (; i + 8 <= n; i += 8) {
+        __m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i), cr = _mm256_loadu_ps(r + i);
+        __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), cr);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const float* pl = planes + p * 4;
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl[0]), cx), _mm256_mul_ps(_mm256_set1_ps(pl[1]), cy)),
+                                        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl[2]), cz), _mm256_set1_ps(pl[3])));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negR, _CMP_GE_OQ));
+        }
+        __m256 dx = _mm256_sub_ps(cx, ex), dy = _mm256_sub_ps(cy, ey), dz = _mm256_sub_ps(cz, ez);
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 reach = _mm256_add_ps(range, cr);
+        int inFrustum = _mm256_movemask_ps(inside);
+        int inRange = _mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_mul_ps(reach, reach), _CMP_LT_OQ));
+        for (int k = 0; k < 8; k++)
+            flags[i + k] = (unsigned char)(((inFrustum >> k) & 1) * CULL_IN_FRUSTUM | ((inRange >> k) & 1) * CULL_IN_RANGE);
+    }
+    CullSpheresScalar(planes, eye, maxDistance, x + i, y + i, z + i, r + i, flags + i, n - i);
+}
+#endif
+
+typedef void (*AddScaledFn)(float*, const float*, float, size_t);
+typedef void (*IntegrateQuaternionsFn)(float*, float*, float*, float*, const float*, const float*, const float*, float, size_t);
+typedef void (*CullSpheresFn)(const float*, const float*, float, const float*, const float*, const float*, const float*, unsigned char*, size_t);
+
+// Widest kernels the running CPU supports, resolved once
+struct SimdKernels {
+    AddScaledFn addScaled;
+    IntegrateQuaternionsFn integrateQuaternions;
+    CullSpheresFn cullSpheres;
+
+    SimdKernels() : addScaled(AddScaledScalar), integrateQuaternions(IntegrateQuaternionsScalar), cullSpheres(CullSpheresScalar) {
+#ifdef SIMD_X86
+        switch (DetectSimdLevel()) {
+            case SIMD_AVX2:
+                addScaled = AddScaledAVX2;
+                integrateQuaternions = IntegrateQuaternionsAVX2;
+                cullSpheres = CullSpheresAVX2;
+                break;
+            case SIMD_SSE:
+                addScaled = AddScaledSSE;
+                integrateQuaternions = IntegrateQuaternionsSSE;
+                cullSpheres = CullSpheresSSE;
+                break;
+            default:
+                break;
+        }
+#endif
+    }
+};
+
+inline const SimdKernels& GetSimdKernels() {
+    static SimdKernels kernels;
+    return kernels;
+}
+
+inline void AddScaled(float* dst, const float* src, float scale, size_t n) {
+    GetSimdKernels().addScaled(dst, src, scale, n);
+}
+
+inline void IntegrateQuaternions(float* qx, float* qy, float* qz, float* qw,
+                                 const float* wx, const float* wy, const float* wz, float dt, size_t n) {
+    GetSimdKernels().integrateQuaternions(qx, qy, qz, qw, wx, wy, wz, dt, n);
+}
+
+inline void CullSpheres(const float* planes, const float* eye, float maxDistance,
+                        const float* x, const float* y, const float* z, const float* r, unsigned char* flags, size_t n) {
+    GetSimdKernels().cullSpheres(planes, eye, maxDistance, x, y, z, r, flags, n);
+}
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Error quadric of Garland & Heckbert: the sum of squared distances to a set
+// of planes, stored as the 10 unique entries of a symmetric 4x4 matrix.
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+    Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+    // Plane ax + by + cz + d = 0 with a unit normal
+    static Quadric FromPlane(double a, double b, double c, double d, double weight) {
+        Quadric q;
+        q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+        q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+        q.c2 = c * c * weight; q.cd = c * d * weight;
+        q.d2 = d * d * weight;
+        return q;
+    }
+
+    void Add(const Quadric& o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+    }
+
+    // Weighted sum of squared plane distances of p
+    double Evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+             + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+             + c2 * z * z + 2.0 * cd * z
+             + d2;
+    }
+};
+
+// Quadric-error edge collapse simplification.
+// Vertices that share a position (UV or normal seams) are welded first so the
+// result has no cracks. Collapses are half-edge collapses onto an existing
+// position, so the returned index buffer references the original vertex array
+// and can share its VBO. Collapses that would flip a triangle are rejected, and
+// open borders get extra perpendicular planes so the silhouette holds.
+// texCoords (optional) picks, for each corner that moved to another position,
+// the vertex of that position with the closest UV.
+// Returns about targetIndexCount indices (more if the mesh can't be reduced
+// further); *resultError receives the square root of the largest collapse cost.
+inline std::vector<unsigned int> SimplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords,
+                                              const std::vector<unsigned int>& indices, size_t targetIndexCount,
+                                              float* resultError = nullptr)
+{
+    struct PositionKey {
+        uint32_t bits[3];
+        bool operator==(const PositionKey& o) const {
+            return bits[0] == o.bits[0] && bits[1] == o.bits[1] && bits[2] == o.bits[2];
+        }
+    };
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey& k) const {
+            return (size_t)(k.bits[0] * 73856093u ^ k.bits[1] * 19349663u ^ k.bits[2] * 83492791u);
+        }
+    };
+    struct Collapse {
+        float cost;
+        uint32_t from, to;
+        uint32_t fromVersion, toVersion;
+        bool operator>(const Collapse& o) const { return cost > o.cost; }
+    };
+
+    // 1. Weld vertices by position
+    std::vector<uint32_t> groupOf(positions.size());
+    std::vector<glm::vec3> groupPos;
+    std::vector<std::vector<uint32_t> > groupVertices;
+    {
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> lookup;
+        for (size_t v = 0; v < positions.size(); v++) {
+            PositionKey key;
+            std::memcpy(key.bits, &positions[v].x, sizeof(key.bits));
+            auto found = lookup.find(key);
+            if (found == lookup.end()) {
+                found = lookup.emplace(key, (uint32_t)groupPos.size()).first;
+                groupPos.push_back(positions[v]);
+                groupVertices.push_back(std::vector<uint32_t>());
+            }
+            groupOf[v] = found->second;
+            groupVertices[found->second].push_back((uint32_t)v);
+        }
+    }
+    size_t groupCount = groupPos.size();
+    size_t triCount = indices.size() / 3;
+
+    std::vector<uint32_t> tris(triCount * 3);
+    for (size_t i = 0; i < triCount * 3; i++)
+        tris[i] = groupOf[indices[i]];
+    std::vector<unsigned char> triDead(triCount, 0);
+    std::vector<std::vector<uint32_t> > groupTris(groupCount);
+    size_t liveTris = 0;
+    for (size_t t = 0; t < triCount; t++) {
+        uint32_t a = tris[t * 3], b = tris[t * 3 + 1], c = tris[t * 3 + 2];
+        if (a == b || b == c || a == c) {
+            triDead[t] = 1;
+            continue;
+        }
+        groupTris[a].push_back((uint32_t)t);
+        groupTris[b].push_back((uint32_t)t);
+        groupTris[c].push_back((uint32_t)t);
+        liveTris++;
+    }
+
+    // 2. Quadrics: area-weighted face planes, plus border planes
+    std::vector<Quadric> quadrics(groupCount);
+    std::unordered_map<uint64_t, int> edgeUses;
+    for (size_t t = 0; t < triCount; t++) {
+        if (triDead[t]) continue;
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+            uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+            edgeUses[key]++;
+        }
+    }
+    for (size_t t = 0; t < triCount; t++) {
+        if (triDead[t]) continue;
+        glm::vec3 p[3] = { groupPos[tris[t * 3]], groupPos[tris[t * 3 + 1]], groupPos[tris[t * 3 + 2]] };
+        glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float doubleArea = glm::length(n);
+        if (doubleArea <= 0.0f) continue;
+        n /= doubleArea;
+        Quadric face = Quadric::FromPlane(n.x, n.y, n.z, -glm::dot(n, p[0]), doubleArea * 0.5);
+        for (int k = 0; k < 3; k++) {
+            quadrics[tris[t * 3 + k]].Add(face);
+
+            uint32_t a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+            uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+            if (edgeUses[key] != 1) continue;
+            glm::vec3 edge = p[(k + 1) % 3] - p[k];
+            glm::vec3 side = glm::cross(edge, n);
+            float sideLength = glm::length(side);
+            if (sideLength <= 0.0f) continue;
+            side /= sideLength;
+            Quadric border = Quadric::FromPlane(side.x, side.y, side.z, -glm::dot(side, p[k]), 10.0 * glm::dot(edge, edge));
+            quadrics[a].Add(border);
+            quadrics[b].Add(border);
+        }
+    }
+
+    // 3. Greedy collapses, cheapest first. Heap entries go stale when either end
+    // changes; they are re-evaluated when popped.
+    std::vector<uint32_t> version(groupCount, 0);
+    std::vector<unsigned char> alive(groupCount, 1);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > heap;
+
+    auto pushEdge = [&](uint32_t a, uint32_t b) {
+        Quadric q = quadrics[a];
+        q.Add(quadrics[b]);
+        double toB = q.Evaluate(groupPos[b]);
+        double toA = q.Evaluate(groupPos[a]);
+        if (toB <= toA)
+            heap.push(Collapse{ (float)toB, a, b, version[a], version[b] });
+        else
+            heap.push(Collapse{ (float)toA, b, a, version[b], version[a] });
+    };
+    auto adjacent = [&](uint32_t a, uint32_t b) {
+        for (uint32_t t : groupTris[a]) {
+            if (triDead[t]) continue;
+            if (tris[t * 3] == b || tris[t * 3 + 1] == b || tris[t * 3 + 2] == b) return true;
+        }
+        return false;
+    };
+    // Would moving `from` onto `to` turn any surviving triangle over?
+    auto flips = [&](uint32_t from, uint32_t to) {
+        for (uint32_t t : groupTris[from]) {
+            if (triDead[t]) continue;
+            glm::vec3 before[3], after[3];
+            bool degenerate = false;
+            for (int k = 0; k < 3; k++) {
+                uint32_t g = tris[t * 3 + k];
+                if (g == to) degenerate = true;
+                before[k] = groupPos[g];
+                after[k] = groupPos[g == from ? to : g];
+            }
+            if (degenerate) continue; // removed by the collapse
+            glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            float l0 = glm::length(n0), l1 = glm::length(n1);
+            if (l1 <= 0.0f || (l0 > 0.0f && glm::dot(n0, n1) < 0.2f * l0 * l1)) return true;
+        }
+        return false;
+    };
+    // Link condition: the two ends may only share the neighbors of the
+    // triangles on their edge, or the collapse pinches the surface
+    std::vector<uint32_t> neighborMark(groupCount, 0);
+    uint32_t markStamp = 0;
+    auto pinches = [&](uint32_t from, uint32_t to) {
+        markStamp++;
+        int sharedTris = 0;
+        for (uint32_t t : groupTris[from]) {
+            if (triDead[t]) continue;
+            bool hasTo = false;
+            for (int k = 0; k < 3; k++) {
+                uint32_t g = tris[t * 3 + k];
+                if (g == to) hasTo = true;
+                neighborMark[g] = markStamp;
+            }
+            if (hasTo) sharedTris++;
+        }
+        int sharedNeighbors = 0;
+        markStamp++;
+        for (uint32_t t : groupTris[to]) {
+            if (triDead[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t g = tris[t * 3 + k];
+                if (g == from || g == to) continue;
+                if (neighborMark[g] == markStamp - 1) {
+                    sharedNeighbors++;
+                    neighborMark[g] = markStamp; // count each once
+                }
+            }
+        }
+        return sharedNeighbors > sharedTris;
+    };
+
+    for (size_t t = 0; t < triCount; t++) {
+        if (triDead[t]) continue;
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+            if (a < b) pushEdge(a, b);
+            else if (edgeUses[(uint64_t)b << 32 | a] == 1) pushEdge(a, b); // border edge seen once
+        }
+    }
+
+    double maxError = 0.0;
+    while (liveTris * 3 > targetIndexCount && !heap.empty()) {
+        Collapse c = heap.top();
+        heap.pop();
+        if (!alive[c.from] || !alive[c.to]) continue;
+        if (c.fromVersion != version[c.from] || c.toVersion != version[c.to]) {
+            if (adjacent(c.from, c.to)) pushEdge(c.from, c.to);
+            continue;
+        }
+        if (flips(c.from, c.to) || pinches(c.from, c.to)) continue;
+
+        alive[c.from] = 0;
+        quadrics[c.to].Add(quadrics[c.from]);
+        version[c.to]++;
+        maxError = std::max(maxError, (double)c.cost);
+
+        for (uint32_t t : groupTris[c.from]) {
+            if (triDead[t]) continue;
+            bool degenerate = false;
+            for (int k = 0; k < 3; k++) {
+                if (tris[t * 3 + k] == c.to) degenerate = true;
+                if (tris[t * 3 + k] == c.from) tris[t * 3 + k] = c.to;
+            }
+            if (degenerate) {
+                triDead[t] = 1;
+                liveTris--;
+            } else {
+                groupTris[c.to].push_back(t);
+            }
+        }
+        groupTris[c.from].clear();
+
+        // Drop dead triangles from the survivor and queue its new edges
+        std::vector<uint32_t>& around = groupTris[c.to];
+        size_t kept = 0;
+        for (uint32_t t : around) {
+            if (triDead[t]) continue;
+            around[kept++] = t;
+            for (int k = 0; k < 3; k++) {
+                uint32_t other = tris[t * 3 + k];
+                if (other != c.to) pushEdge(c.to, other);
+            }
+        }
+        around.resize(kept);
+    }
+
+    // 4. Map every surviving corner back to a vertex of its final position
+    std::vector<unsigned int> result;
+    result.reserve(liveTris * 3);
+    for (size_t t = 0; t < triCount; t++) {
+        if (triDead[t]) continue;
+        for (int k = 0; k < 3; k++) {
+            unsigned int original = indices[t * 3 + k];
+            uint32_t g = tris[t * 3 + k];
+            if (groupOf[original] == g) {
+                result.push_back(original);
+                continue;
+            }
+            const std::vector<uint32_t>& candidates = groupVertices[g];
+            uint32_t best = candidates[0];
+            if (!texCoords.empty()) {
+                float bestDistance = 1e30f;
+                for (uint32_t v : candidates) {
+                    glm::vec2 d = texCoords[v] - texCoords[original];
+                    float distance = glm::dot(d, d);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = v;
+                    }
+                }
+            }
+            result.push_back(best);
+        }
+    }
+
+    if (resultError)
+        *resultError = (float)std::sqrt(maxError);
+    return result;
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <string>
 #include <iostream>
 #include "engine/shader.h"
+#include "engine/gl_state.h"
 #include "libs/stb_image.h"
 
 class Skybox
@@ -37,7 +38,7 @@ public:
 
     void Draw(const glm::mat4& view, const glm::mat4& projection)
     {
-        glDepthFunc(GL_LEQUAL);
+        GLState().DepthFunc(GL_LEQUAL);
         shader.use();
         
         // Remove translation from the view matrix
@@ -46,12 +47,12 @@ public:
         shader.setMat4("view", viewNoTranslation);
         shader.setMat4("projection", projection);
 
-        glBindVertexArray(VAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        GLState().BindVertexArray(VAO);
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
+        GLState().BindVertexArray(0);
+        GLState().DepthFunc(GL_LESS);
     }
 
 private:
@@ -104,7 +105,7 @@ private:
 
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
+        GLState().BindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -115,7 +116,7 @@ private:
     {
         unsigned int textureID;
         glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        GLState().BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
         stbi_set_flip_vertically_on_load(false);
 
@@ -0,0 +1,111 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Uniform-grid broadphase backed by a hash table of cells.
+// Spheres are inserted into every cell their bounding box overlaps, then Build()
+// packs the entries into flat arrays (counting sort by bucket), so a rebuild
+// every frame costs O(n) with no per-cell allocations. Different cells that
+// hash to the same bucket only produce extra candidates for the narrow phase.
+class SpatialHash
+{
+public:
+    float CellSize;
+
+    SpatialHash(float cellSize = 32.0f) : CellSize(cellSize), queryStamp(0) {}
+
+    void Clear()
+    {
+        pending.clear();
+    }
+
+    void Insert(uint32_t id, const glm::vec3& center, float radius)
+    {
+        glm::ivec3 lo = cellOf(center - glm::vec3(radius));
+        glm::ivec3 hi = cellOf(center + glm::vec3(radius));
+        for (int x = lo.x; x <= hi.x; x++)
+            for (int y = lo.y; y <= hi.y; y++)
+                for (int z = lo.z; z <= hi.z; z++)
+                    pending.push_back(Entry{ hashCell(x, y, z), id });
+        if (id >= stamps.size())
+            stamps.resize(id + 1, 0);
+    }
+
+    // Packs the inserted entries into per-bucket ranges
+    void Build()
+    {
+        size_t tableSize = 64;
+        while (tableSize < pending.size() * 2) tableSize *= 2;
+        mask = (uint32_t)(tableSize - 1);
+
+        bucketStart.assign(tableSize + 1, 0);
+        for (const Entry& e : pending)
+            bucketStart[(e.hash & mask) + 1]++;
+        for (size_t i = 1; i <= tableSize; i++)
+            bucketStart[i] += bucketStart[i - 1];
+
+        ids.resize(pending.size());
+        cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+        for (const Entry& e : pending)
+            ids[cursor[e.hash & mask]++] = e.id;
+    }
+
+    // Calls fn(id) once for every entry whose cells overlap the query sphere
+    template <typename Fn>
+    void Query(const glm::vec3& center, float radius, Fn&& fn)
+    {
+        if (ids.empty()) return;
+        if (++queryStamp == 0) {
+            // Stamp counter wrapped, reset so stale stamps can't match
+            std::fill(stamps.begin(), stamps.end(), 0);
+            queryStamp = 1;
+        }
+
+        glm::ivec3 lo = cellOf(center - glm::vec3(radius));
+        glm::ivec3 hi = cellOf(center + glm::vec3(radius));
+        for (int x = lo.x; x <= hi.x; x++)
+            for (int y = lo.y; y <= hi.y; y++)
+                for (int z = lo.z; z <= hi.z; z++) {
+                    uint32_t bucket = hashCell(x, y, z) & mask;
+                    for (uint32_t k = bucketStart[bucket]; k < bucketStart[bucket + 1]; k++) {
+                        uint32_t id = ids[k];
+                        if (stamps[id] == queryStamp) continue;
+                        stamps[id] = queryStamp;
+                        fn(id);
+                    }
+                }
+    }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        uint32_t id;
+    };
+
+    std::vector<Entry> pending;
+    std::vector<uint32_t> bucketStart;
+    std::vector<uint32_t> cursor;
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> stamps;
+    uint32_t mask = 0;
+    uint32_t queryStamp;
+
+    glm::ivec3 cellOf(const glm::vec3& p) const
+    {
+        return glm::ivec3((int)std::floor(p.x / CellSize),
+                          (int)std::floor(p.y / CellSize),
+                          (int)std::floor(p.z / CellSize));
+    }
+
+    static uint32_t hashCell(int x, int y, int z)
+    {
+        return ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u);
+    }
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "libs/glad.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "engine/shader.h"
+#include "engine/gl_state.h"
+#include "engine/instance_buffer.h"
+
+// 5x7 bitmap font, one string per row from the top. Lowercase letters are
+// drawn with the uppercase glyphs; characters missing here draw as a space.
+struct TextGlyphBitmap {
+    char character;
+    const char* rows[7];
+};
+
+const int TEXT_GLYPH_WIDTH = 5;
+const int TEXT_GLYPH_HEIGHT = 7;
+
+const TextGlyphBitmap TEXT_FONT[] = {
+    { '0', { " ### ", "#   #", "#  ##", "# # #", "##  #", "#   #", " ### " } },
+    { '1', { "  #  ", " ##  ", "  #  ", "  #  ", "  #  ", "  #  ", " ### " } },
+    { '2', { " ### ", "#   #", "    #", "   # ", "  #  ", " #   ", "#####" } },
+    { '3', { "#####", "   # ", "  #  ", "   # ", "    #", "#   #", " ### " } },
+    { '4', { "   # ", "  ## ", " # # ", "#  # ", "#####", "   # ", "   # " } },
+    { '5', { "#####", "#    ", "#### ", "    #", "    #", "#   #", " ### " } },
+    { '6', { "  ## ", " #   ", "#    ", "#### ", "#   #", "#   #", " ### " } },
+    { '7', { "#####", "    #", "   # ", "  #  ", " #   ", " #   ", " #   " } },
+    { '8', { " ### ", "#   #", "#   #", " ### ", "#   #", "#   #", " ### " } },
+    { '9', { " ### ", "#   #", "#   #", " ####", "    #", "   # ", " ##  " } },
+    { 'A', { " ### ", "#   #", "#   #", "#####", "#   #", "#   #", "#   #" } },
+    { 'B', { "#### ", "#   #", "#   #", "#### ", "#   #", "#   #", "#### " } },
+    { 'C', { " ### ", "#   #", "#    ", "#    ", "#    ", "#   #", " ### " } },
+    { 'D', { "###  ", "#  # ", "#   #", "#   #", "#   #", "#  # ", "###  " } },
+    { 'E', { "#####", "#    ", "#    ", "#### ", "#    ", "#    ", "#####" } },
+    { 'F', { "#####", "#    ", "#    ", "#### ", "#    ", "#    ", "#    " } },
+    { 'G', { " ### ", "#   #", "#    ", "# ###", "#   #", "#   #", " ####" } },
+    { 'H', { "#   #", "#   #", "#   #", "#####", "#   #", "#   #", "#   #" } },
+    { 'I', { " ### ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", " ### " } },
+    { 'J', { "  ###", "   # ", "   # ", "   # ", "   # ", "#  # ", " ##  " } },
+    { 'K', { "#   #", "#  # ", "# #  ", "##   ", "# #  ", "#  # ", "#   #" } },
+    { 'L', { "#    ", "#    ", "#    ", "#    ", "#    ", "#    ", "#####" } },
+    { 'M', { "#   #", "## ##", "# # #", "# # #", "#   #", "#   #", "#   #" } },
+    { 'N', { "#   #", "#   #", "##  #", "# # #", "#  ##", "#   #", "#   #" } },
+    { 'O', { " ### ", "#   #", "#   #", "#   #", "#   #", "#   #", " ### " } },
+    { 'P', { "#### ", "#   #", "#   #", "#### ", "#    ", "#    ", "#    " } },
+    { 'Q', { " ### ", "#   #", "#   #", "#   #", "# # #", "#  # ", " ## #" } },
+    { 'R', { "#### ", "#   #", "#   #", "#### ", "# #  ", "#  # ", "#   #" } },
+    { 'S', { " ####", "#    ", "#    ", " ### ", "    #", "    #", "#### " } },
+    { 'T', { "#####", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  " } },
+    { 'U', { "#   #", "#   #", "#   #", "#   #", "#   #", "#   #", " ### " } },
+    { 'V', { "#   #", "#   #", "#   #", "#   #", "#   #", " # # ", "  #  " } },
+    { 'W', { "#   #", "#   #", "#   #", "# # #", "# # #", "# # #", " # # " } },
+    { 'X', { "#   #", "#   #", " # # ", "  #  ", " # # ", "#   #", "#   #" } },
+    { 'Y', { "#   #", "#   #", " # # ", "  #  ", "  #  ", "  #  ", "  #  " } },
+    { 'Z', { "#####", "    #", "   # ", "  #  ", " #   ", "#    ", "#####" } },
+    { ':', { "     ", " ##  ", " ##  ", "     ", " ##  ", " ##  ", "     " } },
+    { '.', { "     ", "     ", "     ", "     ", "     ", " ##  ", " ##  " } },
+    { '-', { "     ", "     ", "     ", "#####", "     ", "     ", "     " } },
+    { '+', { "     ", "  #  ", "  #  ", "#####", "  #  ", "  #  ", "     " } },
+    { '/', { "     ", "    #", "   # ", "  #  ", " #   ", "#    ", "     " } },
+    { '(', { "   # ", "  #  ", " #   ", " #   ", " #   ", "  #  ", "   # " } },
+    { ')', { " #   ", "  #  ", "   # ", "   # ", "   # ", "  #  ", " #   " } },
+    { '%', { "##   ", "##  #", "   # ", "  #  ", " #   ", "#  ##", "   ##" } },
+};
+
+// Every HUD string of a frame goes into one vertex buffer and is drawn with a
+// single glDrawArrays, so the cost of the HUD doesn't grow with its text.
+// Glyphs come from an atlas baked from TEXT_FONT at startup.
+class TextRenderer
+{
+public:
+    Shader shader;
+    unsigned int VAO;
+    unsigned int atlasTexture;
+    size_t glyphCount; // glyphs in the last Draw
+
+    TextRenderer() : shader("shaders/text_vertex.glsl", "shaders/text_fragment.glsl"), VAO(0), atlasTexture(0), glyphCount(0)
+    {
+        for (int i = 0; i < 128; i++)
+            glyphIndex[i] = -1;
+        bakeAtlas();
+        setupBuffers();
+        shader.use();
+        shader.setInt("glyphAtlas", 0);
+    }
+
+    // Empties the batch; call once per frame before AddText
+    void Begin()
+    {
+        this->vertices.clear();
+    }
+
+    // Queues text whose first glyph is centered at position (pixels, y up).
+    // size is the glyph height. Returns the x where a following glyph would be centered.
+    float AddText(const std::string& text, glm::vec2 position, float size, glm::vec3 color)
+    {
+        float width = size * TEXT_GLYPH_WIDTH / TEXT_GLYPH_HEIGHT;
+        float advance = size * (TEXT_GLYPH_WIDTH + 1) / TEXT_GLYPH_HEIGHT;
+        uint32_t packed = packColor(color);
+        float x = position.x;
+        for (char c : text) {
+            int glyph = lookup(c);
+            if (glyph >= 0) {
+                glm::vec2 uvMin, uvMax;
+                glyphUVs(glyph, uvMin, uvMax);
+                glm::vec2 p0(x - width * 0.5f, position.y - size * 0.5f);
+                glm::vec2 p1(x + width * 0.5f, position.y + size * 0.5f);
+                this->vertices.push_back(TextVertex{ glm::vec2(p0.x, p0.y), glm::vec2(uvMin.x, uvMin.y), packed });
+                this->vertices.push_back(TextVertex{ glm::vec2(p1.x, p0.y), glm::vec2(uvMax.x, uvMin.y), packed });
+                this->vertices.push_back(TextVertex{ glm::vec2(p1.x, p1.y), glm::vec2(uvMax.x, uvMax.y), packed });
+                this->vertices.push_back(TextVertex{ glm::vec2(p0.x, p0.y), glm::vec2(uvMin.x, uvMin.y), packed });
+                this->vertices.push_back(TextVertex{ glm::vec2(p1.x, p1.y), glm::vec2(uvMax.x, uvMax.y), packed });
+                this->vertices.push_back(TextVertex{ glm::vec2(p0.x, p1.y), glm::vec2(uvMin.x, uvMax.y), packed });
+            }
+            x += advance;
+        }
+        return x;
+    }
+
+    // Draws everything queued since Begin over the whole screen
+    void Draw(int scrWidth, int scrHeight)
+    {
+        this->glyphCount = this->vertices.size() / 6;
+        if (this->vertices.empty())
+            return;
+        this->vertexBuffer.Upload(this->vertices.data(), this->vertices.size() * sizeof(TextVertex));
+
+        // Disable depth test for UI overlay to ensure it draws on top
+        GLState().Disable(GL_DEPTH_TEST);
+        shader.use();
+        shader.setMat4("projection", glm::ortho(0.0f, (float)scrWidth, 0.0f, (float)scrHeight));
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D, this->atlasTexture);
+        GLState().BindVertexArray(this->VAO);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)this->vertices.size());
+        GLState().BindVertexArray(0);
+        GLState().Enable(GL_DEPTH_TEST);
+    }
+
+private:
+    struct TextVertex {
+        glm::vec2 position;
+        glm::vec2 uv;
+        uint32_t color; // RGBA8
+    };
+
+    // Atlas cells are one texel larger than the glyph on each axis, so
+    // neighbouring glyphs never bleed into each other
+    static const int CELL_WIDTH = TEXT_GLYPH_WIDTH + 1;
+    static const int CELL_HEIGHT = TEXT_GLYPH_HEIGHT + 1;
+    static const int ATLAS_COLUMNS = 16;
+
+    InstanceBuffer vertexBuffer;
+    std::vector<TextVertex> vertices;
+    int glyphIndex[128]; // ASCII -> TEXT_FONT entry
+    int atlasWidth, atlasHeight;
+
+    int lookup(char c) const
+    {
+        int code = std::toupper((unsigned char)c);
+        return code >= 0 && code < 128 ? glyphIndex[code] : -1;
+    }
+
+    static uint32_t packColor(const glm::vec3& color)
+    {
+        glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return (uint32_t)c.x | ((uint32_t)c.y << 8) | ((uint32_t)c.z << 16) | (0xFFu << 24);
+    }
+
+    void glyphUVs(int glyph, glm::vec2& uvMin, glm::vec2& uvMax) const
+    {
+        int column = glyph % ATLAS_COLUMNS;
+        int row = glyph / ATLAS_COLUMNS;
+        // Rows are stored bottom-up, matching GL texture coordinates
+        float x0 = (float)(column * CELL_WIDTH);
+        float y0 = (float)(this->atlasHeight - (row + 1) * CELL_HEIGHT);
+        uvMin = glm::vec2(x0 / this->atlasWidth, y0 / this->atlasHeight);
+        uvMax = glm::vec2((x0 + TEXT_GLYPH_WIDTH) / this->atlasWidth, (y0 + TEXT_GLYPH_HEIGHT) / this->atlasHeight);
+    }
+
+    void bakeAtlas()
+    {
+        int count = (int)(sizeof(TEXT_FONT) / sizeof(TEXT_FONT[0]));
+        int rows = (count + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+        this->atlasWidth = ATLAS_COLUMNS * CELL_WIDTH;
+        this->atlasHeight = rows * CELL_HEIGHT;
+        std::vector<unsigned char> pixels(this->atlasWidth * this->atlasHeight, 0);
+
+        for (int g = 0; g < count; g++) {
+            glyphIndex[(int)TEXT_FONT[g].character] = g;
+            int column = g % ATLAS_COLUMNS;
+            int row = g / ATLAS_COLUMNS;
+            int x0 = column * CELL_WIDTH;
+            int y0 = this->atlasHeight - (row + 1) * CELL_HEIGHT;
+            for (int y = 0; y < TEXT_GLYPH_HEIGHT; y++) {
+                // Font rows run top-down, texture rows bottom-up
+                const char* line = TEXT_FONT[g].rows[TEXT_GLYPH_HEIGHT - 1 - y];
+                for (int x = 0; x < TEXT_GLYPH_WIDTH; x++)
+                    if (line[x] == '#')
+                        pixels[(y0 + y) * this->atlasWidth + x0 + x] = 255;
+            }
+        }
+
+        glGenTextures(1, &this->atlasTexture);
+        GLState().ActiveTexture(GL_TEXTURE0);
+        GLState().BindTexture(GL_TEXTURE_2D, this->atlasTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, this->atlasWidth, this->atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // Nearest keeps the pixel font crisp at any integer scale
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLState().BindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void setupBuffers()
+    {
+        this->vertexBuffer.Init(256 * 6 * sizeof(TextVertex));
+        glGenVertexArrays(1, &this->VAO);
+        GLState().BindVertexArray(this->VAO);
+        this->vertexBuffer.Bind();
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, uv));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)offsetof(TextVertex, color));
+        GLState().BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Affine world transform stored as the top three rows of a 4x4 matrix.
+// Each row holds (R * S) in xyz and the translation in w, so transforming a
+// point is three dot products and the implicit last row (0, 0, 0, 1) is never stored.
+struct Affine3x4 {
+    glm::vec4 Rows[3];
+
+    Affine3x4() {
+        Rows[0] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        Rows[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+        Rows[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    }
+
+    // Equivalent to translate(position) * mat4_cast(orientation) * scale(scale)
+    static Affine3x4 FromTRS(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale) {
+        glm::mat3 r = glm::mat3_cast(orientation);
+        Affine3x4 t;
+        for (int row = 0; row < 3; row++)
+            t.Rows[row] = glm::vec4(r[0][row] * scale.x, r[1][row] * scale.y, r[2][row] * scale.z, position[row]);
+        return t;
+    }
+
+    glm::vec3 TransformPoint(const glm::vec3& p) const {
+        glm::vec4 v(p, 1.0f);
+        return glm::vec3(glm::dot(Rows[0], v), glm::dot(Rows[1], v), glm::dot(Rows[2], v));
+    }
+
+    glm::vec3 TransformVector(const glm::vec3& d) const {
+        glm::vec4 v(d, 0.0f);
+        return glm::vec3(glm::dot(Rows[0], v), glm::dot(Rows[1], v), glm::dot(Rows[2], v));
+    }
+
+    glm::vec3 Translation() const {
+        return glm::vec3(Rows[0].w, Rows[1].w, Rows[2].w);
+    }
+
+    glm::mat4 ToMat4() const {
+        glm::mat4 m(1.0f);
+        for (int col = 0; col < 4; col++)
+            for (int row = 0; row < 3; row++)
+                m[col][row] = Rows[row][col];
+        return m;
+    }
+};
+
+// First-order integration of an angular velocity (radians/s) given in world axes.
+// dq/dt = 0.5 * w * q; renormalized so drift never accumulates.
+inline glm::quat IntegrateWorldAngularVelocity(const glm::quat& q, const glm::vec3& omega, float dt) {
+    glm::quat w(0.0f, omega.x, omega.y, omega.z);
+    glm::quat dq = (w * q) * (0.5f * dt);
+    return glm::normalize(q + dq);
+}
+
+// Same as above for an angular velocity given in the body's own axes: dq/dt = 0.5 * q * w
+inline glm::quat IntegrateBodyAngularVelocity(const glm::quat& q, const glm::vec3& omega, float dt) {
+    glm::quat w(0.0f, omega.x, omega.y, omega.z);
+    glm::quat dq = (q * w) * (0.5f * dt);
+    return glm::normalize(q + dq);
+}
+
+#endif
@@ -7,25 +7,13 @@
 #include <string>
 #include <vector>
 #include "engine/shader.h"
+#include "engine/gl_state.h"
+#include "engine/text.h"
 #include "primitives.h"
 #include "camera.h"
 #include "player.h"
 #include "game_item.h"
 
-inline void RenderDigit(Shader& shader, int digit, glm::vec3 position, float size) {
-    if (digit < 0 || digit > 9) return;
-
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, position);
-    // width is usually less than height for digits. 0.6 is good aspect ratio.
-    model = glm::scale(model, glm::vec3(size * 0.6f, size, 1.0f)); 
-    
-    shader.setMat4("model", model);
-    shader.setInt("digit", digit);
-    
-    renderQuad();
-}
-
 inline void RenderCompass(Shader& shader, Camera& camera, const Player& player, const std::vector<Item>& items, int scrWidth, int scrHeight) {
     // Clear depth buffer so compass is drawn on top
     glClear(GL_DEPTH_BUFFER_BIT);
@@ -70,52 +58,30 @@ inline void RenderCompass(Shader& shader, Camera& camera, const Player& player,
     glViewport(0, 0, scrWidth, scrHeight);
 }
 
-inline void RenderUI(Shader& shader, int score, int lives, int scrWidth, int scrHeight) {
-    // Setup Orthographic Projection for 2D overlay
-    // Use -100 to 100 for Z range to ensure cubes are not clipped
-    glm::mat4 projection = glm::ortho(0.0f, (float)scrWidth, 0.0f, (float)scrHeight, -100.0f, 100.0f);
-    glm::mat4 view = glm::mat4(1.0f);
-    
-    // Disable depth test for UI overlay to ensure it draws on top
-    glDisable(GL_DEPTH_TEST);
-
-    shader.use();
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
-    
-    // --- Render Score (Yellow, Top-Left) ---
-    shader.setBool("useUniformColor", true);
-    shader.setVec3("uColor", glm::vec3(1.0f, 1.0f, 0.0f)); 
+// Queues the score, lives and (if not empty) the stats lines into text and
+// draws them all with one call
+inline void RenderUI(TextRenderer& text, int score, int lives, const std::vector<std::string>& statsLines, int scrWidth, int scrHeight) {
+    text.Begin();
 
-    std::string scoreStr = std::to_string(score);
     float size = 40.0f; 
-    float spacing = size * 0.7f;
     float startX = 50.0f;
     float startY = scrHeight - 50.0f;
 
-    for (size_t i = 0; i < scoreStr.length(); i++) {
-        int digit = scoreStr[i] - '0';
-        RenderDigit(shader, digit, glm::vec3(startX + i * spacing, startY, 0.0f), size);
-    }
+    // --- Score (Yellow, Top-Left) ---
+    text.AddText(std::to_string(score), glm::vec2(startX, startY), size, glm::vec3(1.0f, 1.0f, 0.0f));
 
-    // --- Render Lives (Red, Top-Left, below Score) ---
-    shader.setVec3("uColor", glm::vec3(1.0f, 0.0f, 0.0f));
-    
-    std::string livesStr = std::to_string(lives);
-    // Below score
-    float livesStartY = startY - 60.0f; 
+    // --- Lives (Red, Top-Left, below Score) ---
+    text.AddText(std::to_string(lives), glm::vec2(startX, startY - 60.0f), size, glm::vec3(1.0f, 0.0f, 0.0f));
 
-    for (size_t i = 0; i < livesStr.length(); i++) {
-        int digit = livesStr[i] - '0';
-        RenderDigit(shader, digit, glm::vec3(startX + i * spacing, livesStartY, 0.0f), size);
+    // --- Stats (Bottom-Left, first line on top) ---
+    float statsSize = 14.0f;
+    float lineHeight = statsSize * 1.5f;
+    for (size_t i = 0; i < statsLines.size(); i++) {
+        float y = 20.0f + (statsLines.size() - 1 - i) * lineHeight;
+        text.AddText(statsLines[i], glm::vec2(20.0f, y), statsSize, glm::vec3(0.8f, 0.9f, 0.8f));
     }
 
-    shader.setBool("useUniformColor", false);
-    // Reset digit mode
-    shader.setInt("digit", -1); 
-    
-    // Re-enable depth test
-    glEnable(GL_DEPTH_TEST);
+    text.Draw(scrWidth, scrHeight);
 }
 
 #endif
@@ -0,0 +1,132 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include "libs/glad.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+
+#include "engine/shader.h"
+
+// Per-frame state shared by every scene program through std140 uniform
+// blocks: written once per frame, read by any program bound with
+// SceneUniformBlocks::Bind. The structs below mirror the GLSL blocks byte for
+// byte; every vec3 is followed by a float (or padding) as std140 requires.
+
+enum SceneBlockBinding {
+    CAMERA_BLOCK_BINDING = 0,
+    FOG_BLOCK_BINDING = 1,
+    LIGHTS_BLOCK_BINDING = 2
+};
+
+struct CameraBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float padding;
+};
+
+struct FogBlock {
+    glm::vec3 fogColor;
+    float fogStart;
+    float fogEnd;
+    int useFog; // GLSL bool
+    float padding[2];
+};
+
+struct DirLightBlock {
+    glm::vec3 direction;
+    float padding0;
+    glm::vec3 ambient;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 specular;
+    float padding3;
+};
+
+struct SpotLightBlock {
+    glm::vec3 position;
+    float cutOff;
+    glm::vec3 direction;
+    float outerCutOff;
+    glm::vec3 ambient;
+    float constant;
+    glm::vec3 diffuse;
+    float linear;
+    glm::vec3 specular;
+    float quadratic;
+};
+
+// Point lights live in texture buffers (engine/light_clusters.h); the block
+// only carries the cluster grid the shaders need to find them
+struct LightsBlock {
+    DirLightBlock dirLight;
+    SpotLightBlock spotLight;
+    glm::vec2 clusterTileSize; // pixels
+    float clusterNear;
+    float clusterDepthScale;   // slices per unit of log(depth / clusterNear)
+    int clusterCountX;
+    int clusterCountY;
+    int clusterCountZ;
+    float brightness;
+};
+
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match the std140 Camera block");
+static_assert(sizeof(FogBlock) == 32, "FogBlock must match the std140 Fog block");
+static_assert(sizeof(SpotLightBlock) == 80 && sizeof(DirLightBlock) == 64,
+              "light structs must match their std140 layout");
+static_assert(offsetof(LightsBlock, clusterTileSize) == 144 && sizeof(LightsBlock) == 176,
+              "LightsBlock must match the std140 Lights block");
+
+// One uniform buffer attached to a fixed binding point
+class UniformBlock
+{
+public:
+    unsigned int UBO;
+    size_t size; // bytes
+
+    UniformBlock() : UBO(0), size(0) {}
+
+    void Init(GLuint binding, size_t bytes)
+    {
+        size = bytes;
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+    }
+
+    // Replaces the whole block
+    void Update(const void* data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+// The Camera, Fog and Lights blocks. A program only needs Bind once after
+// linking; after that it sees every Update with no per-program uniform calls.
+struct SceneUniformBlocks {
+    UniformBlock camera;
+    UniformBlock fog;
+    UniformBlock lights;
+
+    void Init()
+    {
+        camera.Init(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
+        fog.Init(FOG_BLOCK_BINDING, sizeof(FogBlock));
+        lights.Init(LIGHTS_BLOCK_BINDING, sizeof(LightsBlock));
+    }
+
+    // Attaches whichever of the blocks the program declares
+    void Bind(const Shader& shader) const
+    {
+        shader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        shader.bindUniformBlock("Fog", FOG_BLOCK_BINDING);
+        shader.bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+    }
+};
+
+#endif
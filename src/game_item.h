@@ -4,8 +4,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
+#include <cstddef>
 #include "engine/shader.h"
+#include "engine/gl_state.h"
 #include "engine/primitives.h"
+#include "engine/instance_buffer.h"
+
+// The outline sphere is this much larger than the item
+const float ITEM_OUTLINE_SCALE = 1.1f;
 
 struct Item {
     glm::vec3 position;
@@ -21,59 +27,116 @@ struct Item {
         }
 };
 
-inline void RenderItems(Shader& shader, const std::vector<Item>& items) {
-    // Ensure Depth Test is enabled and configured correctly
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDepthMask(GL_TRUE);
+// Per-instance record for ItemRenderer (item_vertex.glsl, locations 3-5)
+struct ItemInstance {
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec4 color; // rgb, a = 1 when unlit
+};
+static_assert(sizeof(ItemInstance) == 40, "ItemInstance must match the item_vertex.glsl attributes");
 
-    // Enable Stencil Test
-    glEnable(GL_STENCIL_TEST);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-    glStencilMask(0xFF); // Enable writing to stencil buffer
-    
-    shader.setInt("hasDiffuse", 0); 
-    
-    for (const auto& item : items)
+// Draws every item, and then every outline, with one instanced call each, so
+// the draw count doesn't depend on how many items are on screen. The outline
+// is the same stencil technique as before: items write 1 to the stencil
+// buffer, then a larger hull is drawn only where the stencil isn't 1.
+class ItemRenderer
+{
+public:
+    unsigned int VAO;
+    size_t drawnCount;
+
+    ItemRenderer() : VAO(0), drawnCount(0), indexCount(0) {}
+
+    // Shares the sphere buffers of primitives.h; the GL context must be current
+    void Init()
     {
-        // 1st Pass: Draw object normally
+        const SphereGeometry& sphere = GetSphereGeometry();
+        this->indexCount = sphere.indexCount;
+        this->instanceBuffer.Init(64 * sizeof(ItemInstance));
+
+        glGenVertexArrays(1, &this->VAO);
+        GLState().BindVertexArray(this->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphere.VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere.EBO);
+        GLsizei stride = (3 + 3 + 2) * sizeof(float);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+
+        this->instanceBuffer.Bind();
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ItemInstance), (void*)offsetof(ItemInstance, position));
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(ItemInstance), (void*)offsetof(ItemInstance, scale));
+        glVertexAttribDivisor(4, 1);
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(ItemInstance), (void*)offsetof(ItemInstance, color));
+        glVertexAttribDivisor(5, 1);
+        GLState().BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // shader is the item_vertex.glsl + fragment.glsl program
+    void Draw(Shader& shader, const std::vector<Item>& items)
+    {
+        this->drawnCount = items.size();
+        if (items.empty())
+            return;
+
+        this->instances.clear();
+        for (const auto& item : items)
+            this->instances.push_back(ItemInstance{ item.position, item.scale, glm::vec4(item.color, item.isUnlit ? 1.0f : 0.0f) });
+        this->instanceBuffer.Upload(this->instances.data(), this->instances.size() * sizeof(ItemInstance));
+
+        shader.use();
+        shader.setInt("hasDiffuse", 0);
+        shader.setBool("useInstanceColor", true);
+
+        // Ensure Depth Test is enabled and configured correctly
+        GLState().Enable(GL_DEPTH_TEST);
+        GLState().DepthFunc(GL_LESS);
+        GLState().DepthMask(GL_TRUE);
+
+        // Enable Stencil Test
+        GLState().Enable(GL_STENCIL_TEST);
+        GLState().StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+        GLState().BindVertexArray(this->VAO);
+
+        // 1st Pass: Draw objects normally
         // Always pass stencil test, write 1 to stencil buffer
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glStencilMask(0xFF);
-        
-        shader.setBool("isUnlit", item.isUnlit);
-
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, item.position);
-        model = glm::scale(model, item.scale);
-        shader.setMat4("model", model);
-        shader.setVec3("objectColor", item.color);
-        
-        renderSphere();
-        
-        // 2nd Pass: Draw outline
-        // Only draw where stencil value is NOT 1 (i.e., outside the object)
-        glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-        glStencilMask(0x00); // Disable writing to stencil buffer
+        GLState().StencilFunc(GL_ALWAYS, 1, 0xFF);
+        GLState().StencilMask(0xFF);
+        shader.setBool("useSingleColor", false);
+        shader.setFloat("outlineScale", 1.0f);
+        glDrawElementsInstanced(GL_TRIANGLE_STRIP, this->indexCount, GL_UNSIGNED_INT, 0, (GLsizei)this->instances.size());
 
+        // 2nd Pass: Draw outlines
+        // Only draw where stencil value is NOT 1 (i.e., outside the objects)
+        GLState().StencilFunc(GL_NOTEQUAL, 1, 0xFF);
+        GLState().StencilMask(0x00); // Disable writing to stencil buffer
         shader.setBool("useSingleColor", true);
         shader.setVec3("singleColor", glm::vec3(1.0f, 0.5f, 0.0f)); // Orange highlight
-        
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, item.position);
-        model = glm::scale(model, item.scale * 1.1f);
-        shader.setMat4("model", model);
-        
-        renderSphere();
-        
+        shader.setFloat("outlineScale", ITEM_OUTLINE_SCALE);
+        glDrawElementsInstanced(GL_TRIANGLE_STRIP, this->indexCount, GL_UNSIGNED_INT, 0, (GLsizei)this->instances.size());
+
+        GLState().BindVertexArray(0);
         shader.setBool("useSingleColor", false);
-        shader.setBool("isUnlit", false);
+
+        // Restore global state
+        GLState().StencilMask(0xFF);
+        GLState().StencilFunc(GL_ALWAYS, 1, 0xFF);
+        GLState().Disable(GL_STENCIL_TEST);
     }
 
-    // Restore global state
-    glStencilMask(0xFF);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glDisable(GL_STENCIL_TEST);
-}
+private:
+    unsigned int indexCount;
+    InstanceBuffer instanceBuffer;
+    std::vector<ItemInstance> instances;
+};
 
 #endif
@@ -6,13 +6,28 @@
 
 #include <iostream>
 #include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
 
 #include "engine/shader.h"
+#include "engine/gl_state.h"
 #include "engine/model.h"
 #include "engine/primitives.h"
 #include "engine/skybox.h"
 #include "engine/lighting.h"
 #include "engine/ui.h"
+#include "engine/jobs.h"
+#include "engine/random.h"
+#include "engine/impostor_atlas.h"
+#include "engine/gl45.h"
+#include "engine/uniform_blocks.h"
+#include "engine/light_clusters.h"
+#include "engine/render_queue.h"
+#include "engine/frame_graph.h"
+#include "engine/hud_layer.h"
 #include "player.h"
 #include "asteroid.h"
 #include "asteroidField.h"
@@ -34,30 +49,68 @@ float lastFrame = 0.0f;
 
 // Player
 Player player;
+// Asteroid cells are loaded within spawnRadius of the player and dropped past despawnRadius
 const float spawnRadius = 200.0f;
 const float despawnRadius = 300.0f;
 
+// Camera clip planes, shared by the projection, the render queue and the light clusters
+const float cameraNear = 0.1f;
+const float cameraFar = 2000.0f;
+
+// Fog: fully opaque past fogEnd, so asteroids beyond it are culled
+const float fogStart = 100.0f;
+const float fogEnd = 150.0f;
+// Asteroids past this distance are drawn as impostors (a quad from the baked
+// atlas), once they also fit their tile on screen. Starts with the fog, which
+// hides the switch.
+const float impostorDistance = fogStart;
+
+// Seed for every procedural system (override with the first command line argument)
+uint64_t worldSeed = 1337;
+// Random stream ids: asteroid cells stay below 2^61 (see AsteroidOrigin), so the item spawner takes one far above
+const uint64_t ITEM_RNG_STREAM = 1ull << 63;
+
+// Asteroid culling on the GPU (transform feedback) instead of the CPU, toggled with G
+bool gpuCulling = false;
+bool gpuCullingKeyDown = false;
+// GL 4.5 GPU-driven asteroid path (compute culling + multi-draw indirect),
+// on by default when the context supports it, toggled with I
+bool indirectDraw = false;
+bool indirectDrawKeyDown = false;
+// Stats HUD (FPS, frame time, draw and instance counts), toggled with F3
+bool showStats = true;
+bool showStatsKeyDown = false;
+
 // Callbacks
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1)
+        worldSeed = std::strtoull(argv[1], NULL, 10);
+
     // Inicialização do GLFW
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // Criação da janela: tenta um contexto 4.5 core (caminho GPU-driven dos
+    // asteroides) e cai para 3.3 core se o driver não oferecer
+    const int contextVersions[2][2] = { { 4, 5 }, { 3, 3 } };
+    // Dicas valem para a próxima glfwCreateWindow, então vêm antes do laço
+    glfwWindowHint(GLFW_SAMPLES, 4);
+    GLFWwindow* window = NULL;
+    for (int v = 0; v < 2 && window == NULL; v++)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, contextVersions[v][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, contextVersions[v][1]);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
-
-    // Criação da janela
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Trabalho GC", NULL, NULL);
-    glfwWindowHint(GLFW_SAMPLES,4);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Trabalho GC", NULL, NULL);
+    }
     if (window == NULL)
     {
         std::cout << "Falha ao criar janela GLFW" << std::endl;
@@ -78,40 +131,118 @@ int main()
         std::cout << "Falha ao inicializar GLAD" << std::endl;
         return -1;
     }
+    // Funções 4.5 que o glad (3.3) não carrega
+    indirectDraw = GL45().Load((GLADloadproc)glfwGetProcAddress);
+    std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor
+              << (indirectDraw ? " (GPU-driven asteroid path available)" : "") << std::endl;
 
-    glEnable(GL_MULTISAMPLE); 
+    GLState().Enable(GL_MULTISAMPLE); 
 
     Shader shader("shaders/vertex.glsl", "shaders/fragment.glsl");
     Shader instancedShader("shaders/asteroid_instance_vertex.glsl", "shaders/fragment.glsl");
+    Shader itemShader("shaders/item_vertex.glsl", "shaders/fragment.glsl");
     Shader uiShader("shaders/ui_vertex.glsl", "shaders/ui_fragment.glsl");
     Shader shieldShader("shaders/shield_vertex.glsl", "shaders/shield_fragment.glsl");
     Shader propulsionShader("shaders/propulsion_vertex.glsl", "shaders/propulsion_fragment.glsl");
+    std::vector<const char*> cullVaryings = { "outPosScale", "outOrientation", "outLayer", "outMesh" };
+    Shader asteroidCullShader("shaders/asteroid_cull_vertex.glsl", "shaders/asteroid_cull_geometry.glsl", cullVaryings);
+    Shader impostorBakeShader("shaders/impostor_bake_vertex.glsl", "shaders/impostor_bake_fragment.glsl");
+    Shader impostorShader("shaders/asteroid_impostor_vertex.glsl", "shaders/asteroid_impostor_fragment.glsl");
+    // Compute shader só compila num contexto 4.3+
+    std::unique_ptr<Shader> asteroidIndirectShader;
+    if (GL45().loaded)
+        asteroidIndirectShader.reset(new Shader("shaders/asteroid_indirect_compute.glsl"));
+    // fragment.glsl declara um sampler2DArray, que não pode usar a mesma unidade
+    // de textura que os sampler2D (unidade 0 por padrão)
+    shader.use();
+    shader.setInt("texture_array", ASTEROID_TEXTURE_UNIT);
+    itemShader.use();
+    itemShader.setInt("texture_array", ASTEROID_TEXTURE_UNIT);
+    // Câmera, névoa e luzes em uniform blocks, atualizados uma vez por frame
+    // e compartilhados por todos os programas da cena
+    SceneUniformBlocks sceneBlocks;
+    sceneBlocks.Init();
+    sceneBlocks.Bind(shader);
+    sceneBlocks.Bind(instancedShader);
+    sceneBlocks.Bind(itemShader);
+    sceneBlocks.Bind(impostorShader);
+    sceneBlocks.Bind(shieldShader);
+    sceneBlocks.Bind(propulsionShader);
+    // Luzes pontuais agrupadas em clusters, lidas de texture buffers
+    LightClusters lightClusters;
+    lightClusters.Init();
+    LightClusters::SetSamplers(shader);
+    LightClusters::SetSamplers(instancedShader);
+    LightClusters::SetSamplers(itemShader);
+    LightClusters::SetSamplers(impostorShader);
+    std::vector<ScenePointLight> pointLights;
+    // Draws do frame são ordenados por chave antes de ir para a GPU
+    RenderQueue renderQueue;
+    // Passes do frame: ordem, alvos de renderização e tempo de GPU
+    FrameGraph frameGraph;
+#ifndef NDEBUG
+    // O frame só escreve no backbuffer; em debug o autoteste cobre o pool de
+    // alvos transitórios (aliasing e descarte)
+    if (!FrameGraph::SelfTest())
+        std::cout << "ERROR::FRAME_GRAPH:: Self-test failed, transient targets may be wrong" << std::endl;
+#endif
+    // Todos os itens em duas chamadas instanciadas (itens + contornos)
+    ItemRenderer itemRenderer;
+    itemRenderer.Init();
     // Carregar modelo da nave espacial (GLTF)
     Model spaceshipModel("../models/scene.gltf");
  
     // Carregar Skybox
     Skybox skybox;
 
+    // Texto do HUD, desenhado numa única chamada por frame
+    TextRenderer textRenderer;
+    std::vector<std::string> statsLines;
+    float smoothedFrameTime = 0.0f;
+    // O HUD só é redesenhado quando o conteúdo muda; nos outros frames é uma
+    // textura composta com um único draw
+    HudLayer hudLayer;
+    float lastHudStatsTime = 0.0f;
+
     // Asteroid Field Setup
     Model asteroidModel("../models/asteriods/asteroid_03_01.obj", true, true);
-    std::vector<unsigned int> asteroidTextures;
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0001.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0002.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0003.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0004.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0005.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0006.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0007.jpg", "../models/asteriods"));
-    asteroidTextures.push_back(TextureFromFile("space_asteroids_02_l_0008.jpg", "../models/asteriods"));
-
-    AsteroidField asteroidField = AsteroidField(&asteroidModel, asteroidTextures, 2000, spawnRadius, despawnRadius);
+    // LOD 0..3, most of the field is small or far away
+    asteroidModel.GenerateLods(ASTEROID_LOD_LEVELS);
+    // As 8 texturas de asteroide numa única texture array (uma camada por textura)
+    std::vector<std::string> asteroidTextureFiles = {
+        "space_asteroids_02_l_0001.jpg", "space_asteroids_02_l_0002.jpg",
+        "space_asteroids_02_l_0003.jpg", "space_asteroids_02_l_0004.jpg",
+        "space_asteroids_02_l_0005.jpg", "space_asteroids_02_l_0006.jpg",
+        "space_asteroids_02_l_0007.jpg", "space_asteroids_02_l_0008.jpg"
+    };
+    unsigned int asteroidTextureArray = TextureArrayFromFiles(asteroidTextureFiles, "../models/asteriods");
+    int asteroidTextureLayers = (int)asteroidTextureFiles.size();
+
+    // Atlas de impostores: cada mesh vista de 16 direções, com cada textura
+    ImpostorAtlas impostorAtlas;
+    impostorAtlas.Bake(asteroidModel, asteroidTextureArray, asteroidTextureLayers, impostorBakeShader);
+
+    // Worker threads for the per-frame asteroid work
+    JobSystem jobs;
+    std::cout << "Job system: " << jobs.WorkerCount() << " worker threads" << std::endl;
+    std::cout << "World seed: " << worldSeed << std::endl;
+
+    AsteroidField asteroidField = AsteroidField(jobs, worldSeed, &asteroidModel, asteroidTextureArray, asteroidTextureLayers, 6000, spawnRadius, despawnRadius);
+    asteroidField.EnableGpuCulling(asteroidCullShader);
+    if (asteroidIndirectShader)
+        asteroidField.EnableIndirectDraw(*asteroidIndirectShader);
+    asteroidField.EnableImpostors(impostorAtlas, impostorShader, impostorDistance);
+    impostorAtlas.SetUniforms(impostorShader, asteroidField.meshCenters, asteroidField.meshRadii);
     std::vector<Item> items;
 
     // Directional Light Source 
     glm::vec3 sunPos(0.0f, 100.0f, 80.0f); 
 
+    Random itemRng(worldSeed, ITEM_RNG_STREAM);
     float lastItemSpawnTime = 0.0f;
+    float lastStatsTime = 0.0f;
     int score = 0;
+    std::vector<int> asteroidContacts;
 
     // Loop de renderização
     while (!glfwWindowShouldClose(window))
@@ -120,6 +251,8 @@ int main()
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        GLState().BeginFrame();
+        smoothedFrameTime = smoothedFrameTime > 0.0f ? glm::mix(smoothedFrameTime, deltaTime, 0.05f) : deltaTime;
 
         // Item Spawning Logic (Every 5 seconds)
         if (currentFrame - lastItemSpawnTime > 5.0f) {
@@ -130,18 +263,17 @@ int main()
             float x = player.Position.x - spawnDist;
             
             // Random Z within corridor
-            // rand() % 1000 gives 0-999. Divided by 500 gives 0-2. Minus 1 gives -1 to 1.
-            float z = (((rand() % 1000) / 500.0f) - 1.0f) * player.CorridorWidth * 0.9f; 
+            // RangeInt(1000) gives 0-999. Divided by 500 gives 0-2. Minus 1 gives -1 to 1.
+            float z = ((itemRng.RangeInt(1000) / 500.0f) - 1.0f) * player.CorridorWidth * 0.9f; 
             
             // Random Y
-            float y = (((rand() % 1000) / 500.0f) - 1.0f) * 20.0f;
+            float y = ((itemRng.RangeInt(1000) / 500.0f) - 1.0f) * 20.0f;
 
             // Random Color
-            glm::vec3 color(
-                (rand() % 100) / 100.0f,
-                (rand() % 100) / 100.0f,
-                (rand() % 100) / 100.0f
-            );
+            float r = itemRng.RangeInt(100) / 100.0f;
+            float g = itemRng.RangeInt(100) / 100.0f;
+            float b = itemRng.RangeInt(100) / 100.0f;
+            glm::vec3 color(r, g, b);
 
             items.push_back(Item(glm::vec3(x, y, z), glm::vec3(1.5f), color, true,false, currentFrame));
             std::cout << "Spawned Item at: " << x << ", " << y << ", " << z << std::endl;
@@ -154,73 +286,98 @@ int main()
         player.Update(deltaTime, camera);
         
         // Depth test para que a ordem de draw não importe
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
+        GLState().Enable(GL_DEPTH_TEST);
+        GLState().DepthFunc(GL_LESS);
+        GLState().Enable(GL_CULL_FACE);
+        GLState().CullFace(GL_BACK);
+        GLState().FrontFace(GL_CCW);
  
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glStencilMask(0xFF); // Ensure we can clear the stencil buffer
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
         // --- RENDER SKYBOX (First) ---
-        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+        GLState().Enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
  
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 2000.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, cameraNear, cameraFar);
         glm::mat4 view = camera.GetViewMatrix();
-        skybox.Draw(view, projection);
-
-        // Reactivate main shader
-        shader.use();
-        shader.setBool("useSingleColor", false);
+        renderQueue.Begin(camera.Position, cameraFar);
+
+        // Sky last among the opaque draws: it only fills pixels nothing covered
+        renderQueue.Submit(RenderQueue::SkyKey(), [&]() {
+            GLState().Enable(GL_CULL_FACE);
+            GLState().CullFace(GL_BACK);
+            skybox.Draw(view, projection);
+        });
+
+        // --- Per-frame state for every scene program ---
+        CameraBlock cameraBlock;
+        cameraBlock.projection = projection;
+        cameraBlock.view = view;
+        cameraBlock.viewPos = camera.Position;
+        cameraBlock.padding = 0.0f;
+        sceneBlocks.camera.Update(&cameraBlock);
 
-        // --- Light Configuration ---
-        SetupSceneLighting(shader, items, sunPos, player);
-        
         // Fog Configuration
-        shader.setBool("useFog", true);
-        shader.setVec3("fogColor", glm::vec3(0.0f, 0.0f, 0.0f)); 
-        shader.setFloat("fogStart", 100.0f);
-        shader.setFloat("fogEnd", 150.0f);
+        FogBlock fogBlock = FogBlock();
+        fogBlock.useFog = 1;
+        fogBlock.fogColor = glm::vec3(0.0f, 0.0f, 0.0f);
+        fogBlock.fogStart = fogStart;
+        fogBlock.fogEnd = fogEnd;
+        sceneBlocks.fog.Update(&fogBlock);
+
+        // Get current framebuffer size for correct viewport handling
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
 
-        // --- Draw Objects ---
-        shader.setVec3("viewPos", camera.Position);
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
+        // --- Light Configuration ---
+        // Clusters end at fogEnd: point lights don't show through full fog
+        LightsBlock lightsBlock = LightsBlock();
+        SetupSceneLighting(lightsBlock, pointLights, items, sunPos, player);
+        lightClusters.Update(pointLights, view, projection, cameraNear, fogEnd, fbWidth, fbHeight);
+        lightClusters.FillBlock(lightsBlock);
+        sceneBlocks.lights.Update(&lightsBlock);
+        lightClusters.Bind();
 
         // Renderizar modelo da nave espacial
-        player.Draw(shader, spaceshipModel);
+        // The ship covers much of the screen; the foreground layer draws it
+        // before the asteroids and items so it fills the depth buffer first
+        float shipRadius = player.HitboxSize.x * player.ShieldScaleMultiplier;
+        renderQueue.Submit(renderQueue.ForegroundKey(shader, 1, player.Position, shipRadius), [&]() {
+            shader.use();
+            shader.setBool("useSingleColor", false);
+            player.Draw(shader, spaceshipModel);
+        });
 
         // Draw Asteroids
-        instancedShader.use();
-
-        instancedShader.setBool("useSingleColor", false);
- 
-
-        // --- Light Configuration for instancedShader ---
-        SetupSceneLighting(instancedShader, items, sunPos, player);
-
-        // Fog Configuration for instancedShader
-        instancedShader.setBool("useFog", true);
-        instancedShader.setVec3("fogColor", glm::vec3(0.0f, 0.0f, 0.0f)); 
-        instancedShader.setFloat("fogStart", 100.0f);
-        instancedShader.setFloat("fogEnd", 150.0f);
-
-        // --- Draw Objects ---
-        instancedShader.setVec3("viewPos", camera.Position);
-        instancedShader.setMat4("projection", projection);
-        instancedShader.setMat4("view", view);
-
-        asteroidField.UpdateAsteroidField(deltaTime, player.Position, player.GetForwardVector(), currentFrame);
-        asteroidField.DrawAsteroidFieldInstanced(instancedShader);
-
-        shader.use();
+        asteroidField.SetGpuCulling(gpuCulling);
+        asteroidField.SetIndirectDraw(indirectDraw);
+        asteroidField.SetView(projection, view, (float)fbHeight, camera.Position, fogEnd, player.GetSpotlightCone());
+        asteroidField.UpdateAsteroidField(deltaTime, player.Position);
+        // One key for the whole field, which surrounds the ship
+        renderQueue.Submit(renderQueue.OpaqueKey(instancedShader, 0, player.Position, 0.0f), [&]() {
+            instancedShader.use();
+            instancedShader.setBool("useSingleColor", false);
+            asteroidField.DrawAsteroidFieldInstanced(instancedShader);
+        });
+
+        // Culling stats in the window title, once per second
+        if (currentFrame - lastStatsTime > 1.0f) {
+            lastStatsTime = currentFrame;
+            std::string title = "Trabalho GC | asteroids drawn: " + std::to_string(asteroidField.drawnCount) +
+                                " (impostors: " + std::to_string(asteroidField.impostorCount) + ")" +
+                                " culled: " + std::to_string(asteroidField.culledCount) +
+                                (asteroidField.UsingIndirectDraw() ? " (GPU indirect)" : gpuCulling ? " (GPU)" : " (CPU)") +
+                                " | GL state calls: " + std::to_string(GLState().IssuedLastFrame()) +
+                                " (skipped: " + std::to_string(GLState().SkippedLastFrame()) + ")" +
+                                " | lights: " + std::to_string(lightClusters.lightCount) +
+                                " (cluster refs: " + std::to_string(lightClusters.indexCount) + ")" +
+                                " | draws: " + std::to_string(renderQueue.drawCount);
+            for (const FramePassTiming& timing : frameGraph.timings)
+                title += " | " + timing.name + ": " + std::to_string(timing.milliseconds).substr(0, 4) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+        }
 
         // Check Collision
         float playerRadius = player.HitboxSize.x * player.ShieldScaleMultiplier;
-        int hitIndex = asteroidField.CheckAsteroidCollision(player.Position, playerRadius);
-        if (hitIndex != -1) {
+        asteroidField.CheckAsteroidCollision(player.Position, playerRadius, asteroidContacts);
+        if (!asteroidContacts.empty()) {
             if (player.InvulnerabilityTimer <= 0.0f) {
                 player.Lives--;
                 // 2 seconds invulnerability
@@ -231,9 +388,11 @@ int main()
                 }
             }
 
-            // Simple bounce effect
-            glm::vec3 pushDir = glm::normalize(player.Position - asteroidField.asteroids[hitIndex].Position);
-            player.Velocity += pushDir * 10.0f; 
+            // Simple bounce effect, away from every asteroid we are touching
+            for (int hitIndex : asteroidContacts) {
+                glm::vec3 pushDir = glm::normalize(player.Position - asteroidField.asteroids.Position(hitIndex));
+                player.Velocity += pushDir * 10.0f; 
+            }
         }
 
         // Check Item Collection and Expiration
@@ -256,38 +415,92 @@ int main()
             }
         }
 
-        // Renderizar itens (Luzes e Cubos)
-        RenderItems(shader, items);
+        // Renderizar itens (Luzes e Cubos), sorted by the nearest one
+        if (!items.empty()) {
+            const Item* nearestItem = &items[0];
+            for (const Item& item : items)
+                if (glm::distance(item.position, camera.Position) < glm::distance(nearestItem->position, camera.Position))
+                    nearestItem = &item;
+            float itemRadius = nearestItem->scale.x * ITEM_OUTLINE_SCALE;
+            renderQueue.Submit(renderQueue.OpaqueKey(itemShader, 0, nearestItem->position, itemRadius), [&]() {
+                itemRenderer.Draw(itemShader, items);
+            });
+        }
 
         // Draw Engines
-        propulsionShader.use();
-        propulsionShader.setMat4("projection", projection);
-        propulsionShader.setMat4("view", view);
-        player.DrawEngines(propulsionShader, currentFrame);
-
-        // Draw Hitbox (Shield), last for transparency
-        shieldShader.use();
-        shieldShader.setMat4("projection", projection);
-        shieldShader.setMat4("view", view);
-        player.DrawHitbox(shieldShader, camera.Position, currentFrame);
+        glm::vec3 engineCenter;
+        float engineRadius;
+        player.GetEngineBounds(engineCenter, engineRadius);
+        renderQueue.Submit(renderQueue.TransparentKey(propulsionShader, 0, engineCenter, engineRadius), [&]() {
+            player.DrawEngines(propulsionShader, currentFrame);
+        });
+
+        // Draw Hitbox (Shield)
+        renderQueue.Submit(renderQueue.TransparentKey(shieldShader, 0, player.Position, shipRadius), [&]() {
+            player.DrawHitbox(shieldShader, currentFrame);
+        });
 
         // Draw UI Compass
-        // Get current framebuffer size for correct viewport handling
-        int fbWidth, fbHeight;
-        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
-        
-        RenderCompass(uiShader, camera, player, items, fbWidth, fbHeight);
+        renderQueue.Submit(RenderQueue::OverlayKey(), [&]() {
+            RenderCompass(uiShader, camera, player, items, fbWidth, fbHeight);
+        });
+
+        // Stats HUD, refreshed 4 times per second so the cached HUD isn't
+        // rebuilt every frame just for the FPS counter
+        if (!showStats) {
+            statsLines.clear();
+        } else if (statsLines.empty() || currentFrame - lastHudStatsTime > 0.25f) {
+            lastHudStatsTime = currentFrame;
+            statsLines.clear();
+            char line[128];
+            std::snprintf(line, sizeof(line), "FPS %.0f  %.2f MS", 1.0f / std::max(smoothedFrameTime, 1e-6f), smoothedFrameTime * 1000.0f);
+            statsLines.push_back(line);
+            std::snprintf(line, sizeof(line), "ASTEROIDS %zu  IMPOSTORS %zu  CULLED %zu",
+                          asteroidField.drawnCount, asteroidField.impostorCount, asteroidField.culledCount);
+            statsLines.push_back(line);
+            std::snprintf(line, sizeof(line), "ITEMS %zu  LIGHTS %zu  DRAWS %zu  HUD GLYPHS %zu  HUD REDRAWS %zu",
+                          items.size(), lightClusters.lightCount, renderQueue.drawCount, textRenderer.glyphCount, hudLayer.redrawCount);
+            statsLines.push_back(line);
+            for (const FramePassTiming& timing : frameGraph.timings) {
+                std::snprintf(line, sizeof(line), "GPU %s %.2f MS", timing.name.c_str(), timing.milliseconds);
+                statsLines.push_back(line);
+            }
+        }
 
-        // Clear depth again for score overlay
-        glClear(GL_DEPTH_BUFFER_BIT); 
-        RenderUI(uiShader, score, player.Lives, fbWidth, fbHeight);
+        // Score, lives and stats from the cached HUD texture
+        renderQueue.Submit(RenderQueue::OverlayKey(), [&]() {
+            std::string hudKey = std::to_string(score) + " " + std::to_string(player.Lives);
+            for (const std::string& line : statsLines)
+                hudKey += "\n" + line;
+            hudLayer.Draw(hudKey, fbWidth, fbHeight, [&]() {
+                RenderUI(textRenderer, score, player.Lives, statsLines, fbWidth, fbHeight);
+            });
+        });
+
+        // Scene and HUD both go to the window; offscreen passes (prepass,
+        // post-processing) declare their own targets here
+        frameGraph.Begin(fbWidth, fbHeight);
+        int scenePass = frameGraph.AddPass("scene", [&]() {
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            GLState().StencilMask(0xFF); // Ensure we can clear the stencil buffer
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            renderQueue.Flush(RENDER_PASS_SCENE);
+        });
+        frameGraph.Write(scenePass, frameGraph.Backbuffer());
+        int hudPass = frameGraph.AddPass("hud", [&]() {
+            renderQueue.Flush(RENDER_PASS_OVERLAY);
+        });
+        frameGraph.Write(hudPass, frameGraph.Backbuffer());
+        frameGraph.Execute();
 
         // Trocar buffers e verificar eventos
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    // Limpeza
+    // Limpeza: objetos GL antes de destruir o contexto
+    hudLayer.Release();
+    frameGraph.Release();
     glfwTerminate();
     return 0;
 }
@@ -297,6 +510,24 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // G alterna o culling dos asteroides entre CPU e GPU (uma vez por toque)
+    bool gDown = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+    if (gDown && !gpuCullingKeyDown)
+        gpuCulling = !gpuCulling;
+    gpuCullingKeyDown = gDown;
+
+    // I liga/desliga o caminho GL 4.5 (só existe com contexto 4.5)
+    bool iDown = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+    if (iDown && !indirectDrawKeyDown && GL45().loaded)
+        indirectDraw = !indirectDraw;
+    indirectDrawKeyDown = iDown;
+
+    // F3 mostra/esconde as estatísticas
+    bool f3Down = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (f3Down && !showStatsKeyDown)
+        showStats = !showStats;
+    showStatsKeyDown = f3Down;
+
     player.ProcessInput(window, deltaTime);
 }
 
@@ -4,20 +4,30 @@
 #include "libs/glad.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
 #include "engine/model.h"
 #include "engine/shader.h"
+#include "engine/gl_state.h"
 #include "engine/primitives.h"
+#include "engine/transform.h"
+#include "engine/frustum.h"
+#include "engine/uniform_blocks.h"
 
 class Player {
 public:
     // Spaceship state
     glm::vec3 Position;
-    glm::vec3 Rotation; // pitch, yaw, roll
+    glm::quat Orientation;
+    float Heading; // accumulated yaw in degrees, followed by the camera
     glm::vec3 Velocity;
-    glm::vec3 AngularVelocity;
+    glm::vec3 AngularVelocity; // pitch, yaw, roll rates in degrees/s
+
+    // World transform (position + orientation), rebuilt once per Update and
+    // shared by every matrix and direction query below
+    Affine3x4 WorldTransform;
 
     // Physics constants
     float Acceleration;
@@ -46,11 +56,13 @@ public:
     // Model adjustments
     glm::vec3 ModelScale;
     glm::vec3 ModelRotationCorrection;
+    glm::mat4 ModelLocalMatrix; // ModelScale * ModelRotationCorrection, see UpdateModelLocalMatrix
 
     // Constructor
     Player(glm::vec3 startPos = glm::vec3(0.0f)) 
         : Position(startPos), 
-          Rotation(0.0f, 90.0f, 0.0f), 
+          Orientation(glm::angleAxis(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f))),
+          Heading(90.0f),
           Velocity(0.0f), 
           AngularVelocity(0.0f),
           Acceleration(35.0f),
@@ -72,6 +84,20 @@ public:
           ModelScale(0.001f), // Adjusted scale
           ModelRotationCorrection(0.0f, -90.0f, 0.0f) // Adjusted rotation
     {
+        UpdateModelLocalMatrix();
+        UpdateWorldTransform();
+    }
+
+    // Call after changing ModelScale or ModelRotationCorrection
+    void UpdateModelLocalMatrix() {
+        ModelLocalMatrix = glm::scale(glm::mat4(1.0f), ModelScale);
+        ModelLocalMatrix = glm::rotate(ModelLocalMatrix, glm::radians(ModelRotationCorrection.x), glm::vec3(1.0f, 0.0f, 0.0f));
+        ModelLocalMatrix = glm::rotate(ModelLocalMatrix, glm::radians(ModelRotationCorrection.y), glm::vec3(0.0f, 1.0f, 0.0f));
+        ModelLocalMatrix = glm::rotate(ModelLocalMatrix, glm::radians(ModelRotationCorrection.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    void UpdateWorldTransform() {
+        WorldTransform = Affine3x4::FromTRS(Position, Orientation, glm::vec3(1.0f));
     }
 
     void ProcessInput(GLFWwindow* window, float deltaTime) {
@@ -133,7 +159,12 @@ public:
 
         // Physics Update
         Position += Velocity * deltaTime;
-        Rotation += AngularVelocity * deltaTime;
+        // Yaw turns around the world up axis, pitch and roll around the ship's own axes
+        // (same behaviour as the former yaw-pitch-roll Euler angles)
+        glm::vec3 rates = glm::radians(AngularVelocity);
+        Orientation = IntegrateWorldAngularVelocity(Orientation, glm::vec3(0.0f, rates.y, 0.0f), deltaTime);
+        Orientation = IntegrateBodyAngularVelocity(Orientation, glm::vec3(rates.x, 0.0f, rates.z), deltaTime);
+        Heading += AngularVelocity.y * deltaTime;
 
         // Apply friction
         Velocity -= Velocity * Friction * deltaTime;
@@ -158,99 +189,102 @@ public:
             if (Velocity.z < 0) Velocity.z = 0.0f; // Stop velocity against wall
         }
 
+        UpdateWorldTransform();
+
         // Update camera
-        camera.FollowTarget(Position, Rotation.y, CameraDistance, CameraHeight, CameraYawOffset, CameraPitchOffset);
+        camera.FollowTarget(Position, Heading, CameraDistance, CameraHeight, CameraYawOffset, CameraPitchOffset);
+    }
+
+    void SetSpotlight(SpotLightBlock& spot) const {
+        glm::vec3 forward = GetForwardVector();
+        spot.position = Position + forward * 1.5f;
+        spot.direction = forward;
+        spot.ambient = glm::vec3(2.0f, 1.0f, 1.0f);
+        spot.diffuse = glm::vec3(2.5f, 1.5f, 1.5f);
+        spot.specular = glm::vec3(2.0f, 1.0f, 1.0f);
+        spot.constant = 1.0f;
+        spot.linear = 0.0014f;
+        spot.quadratic = 0.000007f;
+        spot.cutOff = glm::cos(glm::radians(12.5f));
+        spot.outerCutOff = glm::cos(glm::radians(15.0f));
     }
 
-    void SetSpotlight(Shader& shader) {
+    // Volume lit by the spotlight set in SetSpotlight (outer cut-off angle)
+    Cone GetSpotlightCone() const {
         glm::vec3 forward = GetForwardVector();
-        shader.setVec3("spotLight.position", Position + forward * 1.5f);
-        shader.setVec3("spotLight.direction", forward);
-        shader.setVec3("spotLight.ambient", 2.0f, 1.0f, 1.0f);
-        shader.setVec3("spotLight.diffuse", 2.5f, 1.5f, 1.5f);
-        shader.setVec3("spotLight.specular", 2.0f, 1.0f, 1.0f);
-        shader.setFloat("spotLight.constant", 1.0f);
-        shader.setFloat("spotLight.linear", 0.0014f);
-        shader.setFloat("spotLight.quadratic", 0.000007f);
-        shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+        return Cone(Position + forward * 1.5f, forward, glm::radians(15.0f));
     }
 
     void Draw(Shader& shader, Model& model) {
         shader.setMat4("model", GetModelMatrix());
         model.Draw(shader);
-        
-        // Update spotlight position and direction
-        shader.setVec3("spotLight.position", Position + GetForwardVector() * 8.0f);
-        shader.setVec3("spotLight.direction", GetForwardVector());
     }
 
     glm::mat4 GetHitboxModelMatrix() {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, Position);
-        model = glm::rotate(model, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        
+        glm::mat4 model = WorldTransform.ToMat4();
         model = glm::scale(model, HitboxSize * ShieldScaleMultiplier);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.4f));
         return model;
     }
 
-    void DrawHitbox(Shader& shader, glm::vec3 viewPos, float time) {
+    void DrawHitbox(Shader& shader, float time) {
         shader.use();
         
         // Enable Blending for transparency
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState().Enable(GL_BLEND);
+        GLState().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         
         // Disable Depth Mask: The shield is transparent, so we don't want it 
         // writing to the depth buffer and hiding things behind it.
-        glDepthMask(GL_FALSE);
+        GLState().DepthMask(GL_FALSE);
         
         // Enable Back-face culling to see only the front of the shield
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
+        GLState().Enable(GL_CULL_FACE);
+        GLState().CullFace(GL_BACK);
 
         // Use the original hitbox model matrix to match the shape
         shader.setMat4("model", GetHitboxModelMatrix());
-        shader.setVec3("viewPos", viewPos);
         shader.setFloat("time", time);
         shader.setBool("isInvulnerable", InvulnerabilityTimer > 0.0f);
 
         renderSphere();
 
         // Restore OpenGL states
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
-        glDisable(GL_CULL_FACE);
+        GLState().DepthMask(GL_TRUE);
+        GLState().Disable(GL_BLEND);
+        GLState().Disable(GL_CULL_FACE);
     }
 
-    void DrawEngines(Shader& shader, float time) {
-        // Calculate thrust level based on Velocity magnitude relative to MaxSpeed
+    // Engine plume size, from Velocity magnitude relative to MaxSpeed
+    float GetThrustLevel() const {
         float thrust = (glm::length(Velocity) / MaxSpeed) * 3.0f;
-        thrust = glm::clamp(thrust, 0.0f, 1.0f); 
+        return glm::clamp(thrust, 0.0f, 1.0f); 
+    }
 
+    // Sphere around the plume drawn by DrawEngines (for draw sorting)
+    void GetEngineBounds(glm::vec3& center, float& radius) const {
+        float length = GetThrustLevel() * 3.5f;
+        center = Position - GetForwardVector() * (0.2f + 0.5f * length);
+        radius = 0.5f * length;
+    }
+
+    void DrawEngines(Shader& shader, float time) {
+        float thrust = GetThrustLevel();
         if (thrust < 0.1f) return;
 
         shader.use();
         
         // Enable additive blending for glowing effect
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE); 
-        glDepthMask(GL_FALSE);
+        GLState().Enable(GL_BLEND);
+        GLState().BlendFunc(GL_SRC_ALPHA, GL_ONE); 
+        GLState().DepthMask(GL_FALSE);
 
         shader.setFloat("time", time);
         shader.setFloat("thrustLevel", thrust);
         shader.setVec3("color", glm::vec3(1.3f, 0.2f, 0.0f)); 
 
         // Engine position relative to ship
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, Position);
-        model = glm::rotate(model, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        
+        glm::mat4 model = WorldTransform.ToMat4();
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.2f)); 
         // Ship faces -Z, so back is +Z
         // Rotate cone to point backward (+Z)
@@ -267,31 +301,17 @@ public:
         renderCone();
 
         // Restore states
-        glDepthMask(GL_TRUE);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDisable(GL_BLEND);
+        GLState().DepthMask(GL_TRUE);
+        GLState().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState().Disable(GL_BLEND);
     }
 
     glm::mat4 GetModelMatrix() const {
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
-        modelMatrix = glm::translate(modelMatrix, Position);
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        
-        modelMatrix = glm::scale(modelMatrix, ModelScale);
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(ModelRotationCorrection.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(ModelRotationCorrection.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(ModelRotationCorrection.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        return modelMatrix;
+        return WorldTransform.ToMat4() * ModelLocalMatrix;
     }
 
     glm::vec3 GetForwardVector() const {
-        glm::mat4 rotationMatrix = glm::mat4(1.0f);
-        rotationMatrix = glm::rotate(rotationMatrix, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        rotationMatrix = glm::rotate(rotationMatrix, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        rotationMatrix = glm::rotate(rotationMatrix, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        return glm::vec3(rotationMatrix * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+        return WorldTransform.TransformVector(glm::vec3(0.0f, 0.0f, -1.0f));
     }
 };
 